@@ -0,0 +1,979 @@
+#include <iostream>
+#include <chrono>
+#include <functional>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <fstream>
+#include <thread>
+#include <random>
+#include "cppJSON.h"
+
+// 堆占用（mallinfo2）和子进程的峰值内存（fork、wait4）只在Linux上测量，其他平台使用近似值或不报告
+#if defined(__linux__)
+#define BENCH_LINUX 1
+#include <malloc.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <malloc.h>
+#endif
+
+using std::cout;
+using std::endl;
+
+/* 统计全局operator new的调用次数和申请的字节数 */
+static std::atomic<size_t> allocation_count{0};
+static std::atomic<size_t> allocation_bytes{0};
+
+void *operator new(size_t size) {
+    ++allocation_count;
+    allocation_bytes += size;
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+// MSVC没有std::aligned_alloc，对齐的内存要用_aligned_malloc申请、_aligned_free释放
+#if defined(_WIN32)
+static void *aligned_allocate(size_t size, size_t align) { return _aligned_malloc(size ? size : 1, align); }
+
+static void aligned_free(void *p) { _aligned_free(p); }
+#else
+static void *aligned_allocate(size_t size, size_t align) {
+    return std::aligned_alloc(align, (size + align - 1) & ~(align - 1));
+}
+
+static void aligned_free(void *p) { std::free(p); }
+#endif
+
+void *operator new(size_t size, std::align_val_t align) {
+    ++allocation_count;
+    allocation_bytes += size;
+    if (void *p = aligned_allocate(size, static_cast<size_t>(align))) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p, std::align_val_t) noexcept { aligned_free(p); }
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept { aligned_free(p); }
+
+/* 堆上实际占用的字节数，含容器的存储和malloc的开销。没有mallinfo2的平台用operator new累计申请的字节数近似，
+ * 不扣除释放的内存，因此释放时的差值为0 */
+static size_t heap_in_use() {
+#if defined(BENCH_LINUX)
+    return mallinfo2().uordblks;
+#else
+    return allocation_bytes;
+#endif
+}
+
+/* 计时辅助函数，返回func执行一次所用的毫秒数 */
+static double time_ms(const std::function<void()> &func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/* 生成约bytes字节、嵌套depth层的JSON文档：最内层是一个记录数组 */
+static string make_nested_document(size_t bytes, int depth) {
+    string doc;
+    doc.reserve(bytes + 64);
+    for (int i = 0; i < depth; ++i) doc += "{\"level\":" + std::to_string(i) + ",\"child\":";
+    doc += "[";
+    for (size_t i = 0; doc.size() < bytes; ++i) {
+        if (i) doc += ",";
+        doc += "{\"id\":" + std::to_string(i) + ",\"name\":\"item" + std::to_string(i) +
+               "\",\"score\":" + std::to_string(i % 100) + ".5,\"ok\":true,\"tags\":[\"a\",\"b\"]}";
+    }
+    doc += "]";
+    for (int i = 0; i < depth; ++i) doc += "}";
+    return doc;
+}
+
+/* 不同文档大小和嵌套深度下的解析耗时 */
+static void bench_parse(const vector<size_t> &sizes_mb) {
+    const int depths[] = {1, 10, 100, 1000};
+    cout << "parse: size(MB) depth time(ms) MB/s" << endl;
+    for (size_t mb: sizes_mb) {
+        for (int depth: depths) {
+            string doc = make_nested_document(mb << 20, depth);
+            double ms = time_ms([&doc]() { JSON json(doc); });
+            cout << "parse: " << mb << " " << depth << " " << ms << " "
+                 << static_cast<double>(doc.size()) / (1 << 20) / (ms / 1000) << endl;
+        }
+    }
+}
+
+/* 严格校验的开销：JSON(str)与try_parse在记录数组和以长字符串（含中文）为主的文档上的吞吐量 */
+static void bench_validate(const vector<size_t> &sizes_mb) {
+    cout << "validate: size(MB) document mode time(ms) MB/s" << endl;
+    for (size_t mb: sizes_mb) {
+        string records = make_nested_document(mb << 20, 1);
+        string text = "[";
+        for (size_t i = 0; text.size() < (mb << 20); ++i) {
+            if (i) text += ",";
+            text += "{\"id\":" + std::to_string(i) + ",\"title\":\"解析器性能测试 record " + std::to_string(i) +
+                    "\",\"body\":\"The quick brown fox jumps over the lazy dog. 敏捷的棕色狐狸跳过了懒狗。\\n"
+                    "Ünïcödé text with escapes \\\"quoted\\\" and emoji \\ud83d\\ude00.\"}";
+        }
+        text += "]";
+        for (const auto &[name, doc]: {std::pair<const char *, const string &>{"records", records}, {"text", text}}) {
+            auto report = [&](const char *mode, double ms) {
+                cout << "validate: " << mb << " " << name << " " << mode << " " << ms << " "
+                     << static_cast<double>(doc.size()) / (1 << 20) / (ms / 1000) << endl;
+            };
+            report("parse", time_ms([&doc]() { JSON json(doc); }));
+            report("try_parse", time_ms([&doc]() {
+                if (!JSON::try_parse(doc)) cout << "validate: unexpected error" << endl;
+            }));
+        }
+    }
+}
+
+/* 遥测数据式的纯数字数组：时间戳、计数、小数和科学计数法混合，以及dump与保留原文解析的耗时 */
+static void bench_numbers(const vector<size_t> &sizes_mb) {
+    cout << "numbers: size(MB) mode time(ms) MB/s allocations" << endl;
+    for (size_t mb: sizes_mb) {
+        string doc = "[";
+        std::mt19937_64 random(42);
+        for (size_t i = 0; doc.size() < (mb << 20); ++i) {
+            if (i) doc += ",";
+            switch (i % 4) {
+                case 0: doc += std::to_string(1700000000000000000ULL + random() % 1000000000ULL); break;
+                case 1: doc += std::to_string(static_cast<long long>(random() % 100000) - 50000); break;
+                case 2: doc += std::to_string(static_cast<double>(random() % 1000000) / 1000); break;
+                default: doc += std::to_string(random() % 1000) + "." + std::to_string(random() % 1000) + "e-3";
+            }
+        }
+        doc += "]";
+        auto report = [&](const char *mode, double ms, size_t allocations) {
+            cout << "numbers: " << mb << " " << mode << " " << ms << " "
+                 << static_cast<double>(doc.size()) / (1 << 20) / (ms / 1000) << " " << allocations << endl;
+        };
+        size_t before = allocation_count;
+        double ms = time_ms([&doc]() { JSON json(doc); });
+        report("parse", ms, allocation_count - before);
+        before = allocation_count;
+        ms = time_ms([&doc]() { JSON json = JSON::parse_preserving_numbers(doc); });
+        report("preserve", ms, allocation_count - before);
+        JSON json(doc);
+        before = allocation_count;
+        ms = time_ms([&json]() { string out = json.dump(); });
+        report("dump", ms, allocation_count - before);
+    }
+}
+
+/* 生成一个包含n条小记录的数组，每条记录都是若干个短标量 */
+static string make_records(size_t n) {
+    string doc = "[";
+    for (size_t i = 0; i < n; ++i) {
+        if (i) doc += ",";
+        doc += "{\"id\":" + std::to_string(i) + ",\"v\":" + std::to_string(i % 7) +
+               ".25,\"ok\":false,\"s\":\"x" + std::to_string(i % 10) + "\",\"n\":null}";
+    }
+    doc += "]";
+    return doc;
+}
+
+/* 默认堆分配与JSONDocument内存池分配的对比：解析加析构的总耗时及operator new调用次数 */
+static void bench_arena(const vector<size_t> &sizes_mb) {
+    cout << "arena: records mode time(ms) allocations" << endl;
+    for (size_t mb: sizes_mb) {
+        size_t records = (mb << 20) / 64;
+        string doc = make_records(records);
+        size_t before = allocation_count;
+        double ms = time_ms([&doc]() { JSON json(doc); });
+        cout << "arena: " << records << " heap " << ms << " " << allocation_count - before << endl;
+        before = allocation_count;
+        ms = time_ms([&doc]() { JSONDocument json(doc); });
+        cout << "arena: " << records << " document " << ms << " " << allocation_count - before << endl;
+    }
+}
+
+/* 不同键个数的JSON对象上，at()与operator[]查找已有键的平均耗时 */
+static void bench_lookup() {
+    const size_t key_counts[] = {10, 1000, 100000};
+    const size_t lookups = 1000000;
+    cout << "lookup: keys ns/at ns/operator[]" << endl;
+    for (size_t n: key_counts) {
+        string doc = "{";
+        vector<string> keys;
+        for (size_t i = 0; i < n; ++i) {
+            keys.push_back("field_" + std::to_string(i));
+            doc += (i ? ",\"" : "\"") + keys.back() + "\":" + std::to_string(i);
+        }
+        doc += "}";
+        JSON json(doc);
+        long long sum = 0;
+        double at_ms = time_ms([&]() {
+            for (size_t i = 0; i < lookups; ++i) sum += static_cast<long long>(json.at(keys[i * 7919 % n]));
+        });
+        double index_ms = time_ms([&]() {
+            for (size_t i = 0; i < lookups; ++i) sum += static_cast<long long>(json[keys[i * 7919 % n]]);
+        });
+        cout << "lookup: " << n << " " << at_ms * 1e6 / lookups << " " << index_ms * 1e6 / lookups
+             << (sum == 0 ? " " : "") << endl;
+    }
+}
+
+/* 以日志记录为样本的解析吞吐量：长字符串值和带缩进的格式化文档，主要耗时在字符串和空白的扫描上 */
+static void bench_scan(const vector<size_t> &sizes_mb) {
+    const string message(200, 'm');
+    cout << "scan: size(MB) layout time(ms) MB/s" << endl;
+    for (size_t mb: sizes_mb) {
+        for (int pretty = 0; pretty < 2; ++pretty) {
+            string indent = pretty ? "\n                " : "";
+            string doc = "[";
+            for (size_t i = 0; doc.size() < (mb << 20); ++i) {
+                if (i) doc += ",";
+                doc += indent + "{" + indent + "\"host\": \"web-" + std::to_string(i % 32) + ".example.com\"," +
+                       indent + "\"message\": \"" + message + "\\\"quoted\\\" " + message + "\"" + indent + "}";
+            }
+            doc += "]";
+            double ms = time_ms([&doc]() { JSON json(doc); });
+            cout << "scan: " << mb << (pretty ? " pretty " : " compact ") << ms << " "
+                 << static_cast<double>(doc.size()) / (1 << 20) / (ms / 1000) << endl;
+        }
+    }
+}
+
+/* 只统计记录中"id"字段之和的SAX处理器 */
+class SumIdHandler : public JSONHandler {
+public:
+    bool key(std::string_view k) override {
+        in_id = k == "id";
+        return true;
+    }
+
+    bool int64_value(long long v) override {
+        if (in_id) sum += v;
+        return true;
+    }
+
+    long long sum = 0;
+
+private:
+    bool in_id = false;
+};
+
+/* 统计所有记录的"id"之和：SAX事件解析与先用JSON(const string &)构造DOM再遍历的对比 */
+static void bench_sax(const vector<size_t> &sizes_mb) {
+    cout << "sax: records mode time(ms) allocations" << endl;
+    for (size_t mb: sizes_mb) {
+        size_t records = (mb << 20) / 64;
+        string doc = make_records(records);
+        long long dom_sum = 0;
+        size_t before = allocation_count;
+        double ms = time_ms([&doc, &dom_sum]() {
+            JSON json(doc);
+            for (size_t i = 0; i < json.size(); ++i) dom_sum += static_cast<long long>(json[static_cast<int>(i)]["id"]);
+        });
+        cout << "sax: " << records << " dom " << ms << " " << allocation_count - before << endl;
+        SumIdHandler handler;
+        before = allocation_count;
+        ms = time_ms([&doc, &handler]() { parse_sax(doc, handler); });
+        cout << "sax: " << records << " sax " << ms << " " << allocation_count - before
+             << (handler.sum == dom_sum ? "" : " MISMATCH") << endl;
+    }
+}
+
+/* 序列化耗时：operator<<写入ostringstream与dump()写入string的对比 */
+static void bench_dump(const vector<size_t> &sizes_mb) {
+    cout << "dump: records mode time(ms) MB/s" << endl;
+    for (size_t mb: sizes_mb) {
+        size_t records = (mb << 20) / 64;
+        JSON json(make_records(records));
+        size_t bytes = 0;
+        double ms = time_ms([&json, &bytes]() {
+            std::ostringstream out;
+            out << json;
+            bytes = out.str().size();
+        });
+        cout << "dump: " << records << " ostream " << ms << " " << static_cast<double>(bytes) / (1 << 20) / (ms / 1000)
+             << endl;
+        ms = time_ms([&json, &bytes]() { bytes = json.dump().size(); });
+        cout << "dump: " << records << " compact " << ms << " " << static_cast<double>(bytes) / (1 << 20) / (ms / 1000)
+             << endl;
+        ms = time_ms([&json, &bytes]() { bytes = json.dump(2).size(); });
+        cout << "dump: " << records << " pretty " << ms << " " << static_cast<double>(bytes) / (1 << 20) / (ms / 1000)
+             << endl;
+    }
+}
+
+/* 文本与MessagePack的往返：编码、解码的耗时和编码后的大小，分别经过流和内存缓冲区 */
+static void bench_msgpack(const vector<size_t> &sizes_mb) {
+    cout << "msgpack: records mode encode(ms) decode(ms) bytes" << endl;
+    for (size_t mb: sizes_mb) {
+        size_t records = (mb << 20) / 64;
+        JSON json(make_records(records));
+        auto report = [&](const char *mode, double encode, double decode, size_t bytes) {
+            cout << "msgpack: " << records << " " << mode << " " << encode << " " << decode << " " << bytes << endl;
+        };
+        {
+            std::stringstream stream;
+            double encode = time_ms([&]() { stream << json; });
+            double decode = time_ms([&]() { JSON copy; stream >> copy; });
+            report("text-stream", encode, decode, stream.str().size());
+        }
+        {
+            string text;
+            double encode = time_ms([&]() { text = json.dump(); });
+            double decode = time_ms([&]() { JSON copy(text); });
+            report("text-buffer", encode, decode, text.size());
+        }
+        {
+            std::stringstream stream;
+            double encode = time_ms([&]() { json.dump_msgpack(stream); });
+            double decode = time_ms([&]() { JSON copy = JSON::parse_msgpack(stream); });
+            report("msgpack-stream", encode, decode, stream.str().size());
+        }
+        {
+            string data;
+            double encode = time_ms([&]() { data = json.dump_msgpack(); });
+            double decode = time_ms([&]() { JSON copy = JSON::parse_msgpack(data); });
+            report("msgpack-buffer", encode, decode, data.size());
+        }
+    }
+}
+
+/* 相等比较耗时：两份相同的文档、第一个值就不同的文档，以及忽略键顺序的比较 */
+static void bench_equal(const vector<size_t> &sizes_mb) {
+    cout << "equal: records case time(ms)" << endl;
+    for (size_t mb: sizes_mb) {
+        size_t records = (mb << 20) / 64;
+        string doc = make_records(records);
+        JSON json1(doc), json2(doc), json3(doc);
+        json3[0]["id"] = -1;
+        bool result = false;
+        double ms = time_ms([&]() { result = json1 == json2; });
+        cout << "equal: " << records << " equal " << ms << (result ? "" : " WRONG") << endl;
+        ms = time_ms([&]() { result = json1 == json3; });
+        cout << "equal: " << records << " first-differs " << ms << (result ? " WRONG" : "") << endl;
+        ms = time_ms([&]() { result = JSONEqual(json1, json2, true); });
+        cout << "equal: " << records << " equal-unordered " << ms << (result ? "" : " WRONG") << endl;
+    }
+}
+
+/* 构建含n个小对象的数组：push_back拷贝与移动的对比，以及把建好的数组整体移走，统计耗时和operator new调用次数 */
+static void bench_move(const vector<size_t> &sizes_mb) {
+    cout << "move: elements mode time(ms) allocations" << endl;
+    const JSON proto("{\"id\":0,\"name\":\"a fairly long name that does not fit in SSO\",\"tags\":[\"a\",\"b\"]}");
+    for (size_t mb: sizes_mb) {
+        size_t n = (mb << 20) / 64;
+        for (int move = 0; move < 2; ++move) {
+            JSON array("[]");
+            size_t before = allocation_count;
+            double ms = time_ms([&]() {
+                for (size_t i = 0; i < n; ++i) {
+                    JSON item = proto;
+                    item["id"] = static_cast<long long>(i);
+                    if (move) array.push_back(std::move(item)); else array.push_back(item);
+                }
+            });
+            cout << "move: " << n << (move ? " push_back-move " : " push_back-copy ") << ms << " "
+                 << allocation_count - before << endl;
+            if (move) {
+                JSON moved("[]");
+                before = allocation_count;
+                ms = time_ms([&array, &moved]() { moved = std::move(array); });
+                cout << "move: " << n << " move-whole " << ms << " " << allocation_count - before << endl;
+            }
+        }
+    }
+}
+
+/* 大配置文档的拷贝：深拷贝与snapshot()的对比，以及取快照后修改一个叶子所复制的数据量 */
+static void bench_snapshot(const vector<size_t> &sizes_mb) {
+    cout << "snapshot: records mode time(ms) allocations bytes" << endl;
+    for (size_t mb: sizes_mb) {
+        size_t records = (mb << 20) / 64;
+        JSON config("{\"settings\":{\"timeout\":30,\"retries\":3},\"records\":" + make_records(records) + "}");
+        size_t before = allocation_count, before_bytes = allocation_bytes;
+        double ms = time_ms([&config]() { JSON copy = config; });
+        cout << "snapshot: " << records << " deep-copy " << ms << " " << allocation_count - before << " "
+             << allocation_bytes - before_bytes << endl;
+        before = allocation_count, before_bytes = allocation_bytes;
+        JSON snapshot = config.snapshot();
+        ms = time_ms([&config, &snapshot]() { snapshot = config.snapshot(); });
+        cout << "snapshot: " << records << " snapshot " << ms << " " << allocation_count - before << " "
+             << allocation_bytes - before_bytes << endl;
+        before = allocation_count, before_bytes = allocation_bytes;
+        ms = time_ms([&config]() { config["settings"]["timeout"] = 60; });
+        cout << "snapshot: " << records << " mutate-small-path " << ms << " " << allocation_count - before << " "
+             << allocation_bytes - before_bytes << endl;
+        before = allocation_count, before_bytes = allocation_bytes;
+        ms = time_ms([&config, records]() { config["records"][static_cast<int>(records / 2)]["id"] = -1; });
+        cout << "snapshot: " << records << " mutate-in-large-array " << ms << " " << allocation_count - before << " "
+             << allocation_bytes - before_bytes
+             << (static_cast<long long>(snapshot["settings"]["timeout"]) == 30 ? "" : " WRONG") << endl;
+    }
+}
+
+/* 每个JSON值占用的内存：分别解析整数数组、短字符串数组和记录数组，统计解析时operator new的调用次数，
+ * 解析结束后堆上实际占用的字节数（heap_in_use），以及按下标遍历整个数组的耗时 */
+static void bench_footprint(const vector<size_t> &sizes_mb) {
+    cout << "footprint: sizeof(JSON) " << sizeof(JSON) << endl;
+    cout << "footprint: values shape allocations heap-bytes bytes/value traverse(ms)" << endl;
+    for (size_t mb: sizes_mb) {
+        size_t n = (mb << 20) / 64;
+        string docs[3] = {"[", "[", make_records(n)};
+        for (size_t i = 0; i < n; ++i) {
+            docs[0] += (i ? "," : "") + std::to_string(i);
+            docs[1] += (i ? ",\"s" : "\"s") + std::to_string(i % 1000) + "\"";
+        }
+        docs[0] += "]", docs[1] += "]";
+        const char *shapes[] = {"int-array", "short-string-array", "records"};
+        for (int shape = 0; shape < 3; ++shape) {
+            size_t values = shape == 2 ? 6 * n + 1 : n + 1;
+            size_t before = allocation_count, heap = heap_in_use();
+            const JSON json(docs[shape]);
+            size_t count = allocation_count - before;
+            heap = heap_in_use() - heap;
+            size_t sum = 0;
+            double ms = time_ms([&]() {
+                for (int i = 0; i < static_cast<int>(n); ++i) {
+                    if (shape == 0) sum += static_cast<long long>(json[i]);
+                    else if (shape == 1) sum += static_cast<string>(json[i]).size();
+                    else sum += static_cast<long long>(json[i].at("id"));
+                }
+            });
+            cout << "footprint: " << values << " " << shapes[shape] << " " << count << " " << heap << " "
+                 << static_cast<double>(heap) / values << " " << ms << (sum ? "" : " ") << endl;
+        }
+    }
+}
+
+/* 键相同的大量记录：每条记录20个键，其中一半超过短字符串的容量。对比解析、拷贝时分配的次数和堆占用 */
+static void bench_keys(const vector<size_t> &sizes_mb) {
+    cout << "keys: records mode time(ms) allocations heap-bytes" << endl;
+    for (size_t mb: sizes_mb) {
+        string doc = "[";
+        size_t records = 0;
+        while (doc.size() < (mb << 20)) {
+            doc += records++ ? ",{" : "{";
+            for (int k = 0; k < 20; ++k) {
+                doc += k ? ",\"" : "\"";
+                doc += k % 2 ? "field_" + std::to_string(k) : "customer_attribute_" + std::to_string(k);
+                doc += "\":" + std::to_string((records + k) % 100);
+            }
+            doc += "}";
+        }
+        doc += "]";
+        auto report = [&](const char *mode, const std::function<void()> &func) {
+            size_t before = allocation_count, heap = heap_in_use();
+            double ms = time_ms(func);
+            cout << "keys: " << records << " " << mode << " " << ms << " " << allocation_count - before << " "
+                 << static_cast<long long>(heap_in_use() - heap) << endl;
+        };
+        std::optional<JSON> json, copy;
+        report("parse", [&]() { json.emplace(doc); });
+        report("copy", [&]() { copy.emplace(*json); });
+        long long sum = 0;
+        report("lookup", [&]() {
+            const JSON &values = *json;
+            for (int i = 0; i < static_cast<int>(values.size()); ++i)
+                sum += static_cast<long long>(values[i].at("customer_attribute_10"));
+        });
+        report("free", [&]() { json.reset(), copy.reset(); });
+        if (sum == 0) cout << endl;
+    }
+}
+
+/* 读取混合类型的标量数组：先用is*()检查类型再转换、用try_get逐个尝试，以及直接转换并捕获类型不符的异常 */
+static void bench_accessors(const vector<size_t> &sizes_mb) {
+    cout << "accessors: values mode time(ms)" << endl;
+    for (size_t mb: sizes_mb) {
+        size_t n = (mb << 20) / 8;
+        string doc = "[";
+        for (size_t i = 0; i < n; ++i) {
+            if (i) doc += ",";
+            switch (i % 4) {
+                case 0: doc += std::to_string(i); break;
+                case 1: doc += std::to_string(i % 100) + ".5"; break;
+                case 2: doc += "\"v" + std::to_string(i % 10) + "\""; break;
+                default: doc += i % 8 == 3 ? "true" : "false";
+            }
+        }
+        doc += "]";
+        const JSON json(doc);
+        double sum = 0;
+        double ms = time_ms([&]() {
+            for (int i = 0; i < static_cast<int>(n); ++i) {
+                const JSON &v = json[i];
+                if (v.isInteger()) sum += static_cast<long long>(v);
+                else if (v.isFloat()) sum += static_cast<double>(v);
+                else if (v.isBool()) sum += static_cast<bool>(v);
+                else if (v.isString()) sum += 1;
+            }
+        });
+        cout << "accessors: " << n << " is-then-convert " << ms << endl;
+        ms = time_ms([&]() {
+            for (int i = 0; i < static_cast<int>(n); ++i) {
+                const JSON &v = json[i];
+                if (auto x = v.try_get<long long>()) sum += *x;
+                else if (auto d = v.try_get<double>()) sum += *d;
+                else if (auto b = v.try_get<bool>()) sum += *b;
+                else if (auto s = v.try_get<std::string_view>()) sum += 1;
+            }
+        });
+        cout << "accessors: " << n << " try_get " << ms << endl;
+        ms = time_ms([&]() {
+            for (int i = 0; i < static_cast<int>(n); ++i) {
+                try {
+                    sum += static_cast<long long>(json[i]);
+                } catch (const std::runtime_error &) {
+                }
+            }
+        });
+        cout << "accessors: " << n << " convert-or-catch " << ms << (sum == 0 ? " " : "") << endl;
+    }
+}
+
+/* 只读取大文档中的几个字段：完整解析（JSON和JSONDocument）与延迟解析的对比，以及延迟解析后再遍历全部记录的耗时 */
+static void bench_lazy(const vector<size_t> &sizes_mb) {
+    cout << "lazy: size(MB) mode time(ms) allocations" << endl;
+    for (size_t mb: sizes_mb) {
+        string records = make_records((mb << 20) / 64);
+        string doc = R"({"meta":{"version":3,"source":"bench"},"records":)" + records +
+                     R"(,"summary":{"count":)" + std::to_string((mb << 20) / 64) + "}}";
+        long long sum = 0;
+        auto read_fields = [&sum](JSON &root) {
+            sum += static_cast<long long>(root["meta"]["version"]) + static_cast<long long>(root["summary"]["count"]) +
+                   static_cast<long long>(root["records"][10]["id"]);
+        };
+        size_t before = allocation_count;
+        double ms = time_ms([&]() {
+            JSON json(doc);
+            read_fields(json);
+        });
+        cout << "lazy: " << mb << " eager " << ms << " " << allocation_count - before << endl;
+        before = allocation_count;
+        ms = time_ms([&]() {
+            JSONDocument document(doc);
+            read_fields(document.root());
+        });
+        cout << "lazy: " << mb << " document " << ms << " " << allocation_count - before << endl;
+        string text = doc;
+        before = allocation_count;
+        ms = time_ms([&]() {
+            JSONDocument document = JSONDocument::parse_lazy(std::move(text));
+            read_fields(document.root());
+        });
+        cout << "lazy: " << mb << " lazy " << ms << " " << allocation_count - before << endl;
+        text = doc;
+        before = allocation_count;
+        ms = time_ms([&]() {
+            JSONDocument document = JSONDocument::parse_lazy(std::move(text));
+            JSON &values = document.root()["records"];
+            for (int i = 0; i < static_cast<int>(values.size()); ++i) sum += static_cast<long long>(values[i]["id"]);
+        });
+        cout << "lazy: " << mb << " lazy-traverse-all " << ms << " " << allocation_count - before
+             << (sum ? "" : " ") << endl;
+    }
+}
+
+/* 只读文档：JSON与JSONTape的解析耗时、分配次数和字节数，遍历全部记录读取字段的耗时，以及转换为JSON的耗时 */
+static void bench_tape(const vector<size_t> &sizes_mb) {
+    cout << "tape: records mode time(ms) allocations bytes" << endl;
+    for (size_t mb: sizes_mb) {
+        size_t records = (mb << 20) / 64;
+        string doc = make_records(records);
+        auto report = [&](const char *mode, double ms, size_t allocations, size_t bytes) {
+            cout << "tape: " << records << " " << mode << " " << ms << " " << allocations << " " << bytes << endl;
+        };
+        size_t before = allocation_count, bytes_before = allocation_bytes;
+        std::optional<JSON> json;
+        double ms = time_ms([&]() { json.emplace(doc); });
+        report("parse-json", ms, allocation_count - before, allocation_bytes - bytes_before);
+        before = allocation_count, bytes_before = allocation_bytes;
+        std::optional<JSONTape> tape;
+        ms = time_ms([&]() { tape.emplace(doc); });
+        report("parse-tape", ms, allocation_count - before, allocation_bytes - bytes_before);
+        long long sum = 0;
+        ms = time_ms([&]() {
+            const JSON &values = *json;
+            for (int i = 0; i < static_cast<int>(values.size()); ++i)
+                sum += static_cast<long long>(values[i].at("id")) + values[i].at("s").try_get<std::string_view>()->size();
+        });
+        report("read-json", ms, 0, 0);
+        ms = time_ms([&]() {
+            for (auto record = tape->root().child(); !record.at_end(); record = record.next())
+                sum += static_cast<long long>(record.at("id")) + static_cast<std::string_view>(record.at("s")).size();
+        });
+        report("read-tape", ms, 0, 0);
+        ms = time_ms([&]() { JSON copy = tape->to_json(); });
+        report("to-json", ms, 0, 0);
+        ms = time_ms([&]() { json.reset(); });
+        report("free-json", ms, 0, 0);
+        ms = time_ms([&]() { tape.reset(); });
+        report("free-tape", ms, 0, sum ? 0 : 1);
+    }
+}
+
+/* 与make_nested_document中记录对应的结构体 */
+struct BenchItem {
+    long long id = 0;
+    string name;
+    double score = 0;
+    bool ok = false;
+    vector<string> tags;
+};
+
+CPPJSON_BIND(BenchItem, id, name, score, ok, tags)
+
+/* 记录数组与结构体数组互相转换：先解析成JSON再逐个取字段，对比直接用parse_struct读入；
+ * 序列化时对比先组装JSON再dump和直接dump_struct */
+static void bench_struct(const vector<size_t> &sizes_mb) {
+    cout << "struct: size(MB) mode time(ms) allocations" << endl;
+    for (size_t mb: sizes_mb) {
+        string doc = make_nested_document(mb << 20, 0);
+        auto report = [&](const char *mode, const std::function<void()> &func) {
+            size_t before = allocation_count;
+            double ms = time_ms(func);
+            cout << "struct: " << mb << " " << mode << " " << ms << " " << allocation_count - before << endl;
+        };
+        vector<BenchItem> items;
+        report("parse-dom", [&]() {
+            const JSON json(doc);
+            items.resize(json.size());
+            for (int i = 0; i < static_cast<int>(json.size()); ++i) {
+                const JSON &record = json[i];
+                BenchItem &item = items[i];
+                item.id = static_cast<long long>(record.at("id"));
+                item.name = static_cast<string>(record.at("name"));
+                item.score = static_cast<double>(record.at("score"));
+                item.ok = static_cast<bool>(record.at("ok"));
+                const JSON &tags = record.at("tags");
+                item.tags.resize(tags.size());
+                for (int j = 0; j < static_cast<int>(tags.size()); ++j) item.tags[j] = static_cast<string>(tags[j]);
+            }
+        });
+        items.clear();
+        report("parse-struct", [&]() { parse_struct(doc, items); });
+        string out;
+        report("dump-dom", [&]() {
+            JSON json("[]");
+            for (const BenchItem &item: items) {
+                JSON record("{}");
+                record["id"] = item.id;
+                record["name"] = item.name;
+                record["score"] = item.score;
+                record["ok"] = item.ok;
+                JSON tags("[]");
+                for (const string &tag: item.tags) tags.push_back(tag);
+                record["tags"] = std::move(tags);
+                json.push_back(std::move(record));
+            }
+            out = json.dump();
+        });
+        size_t dom_size = out.size();
+        report("dump-struct", [&]() { out = dump_struct(items); });
+        if (out.size() != dom_size) cout << "struct: output mismatch" << endl;
+    }
+}
+
+/* 对大量小文档取同一个嵌套的值：链式调用at、每次解析路径的at_pointer，以及编译好的JSONPointer。
+ * 每10个文档中有1个缺少中间的键，链式调用和at_pointer通过捕获异常处理，JSONPointer返回空指针 */
+static void bench_pointer(const vector<size_t> &sizes_mb) {
+    cout << "pointer: documents mode time(ms) allocations" << endl;
+    for (size_t mb: sizes_mb) {
+        size_t n = (mb << 20) / 128;
+        vector<JSON> docs(n);
+        for (size_t i = 0; i < n; ++i) {
+            string route = i % 10 == 9 ? "\"fallback\":true" : "\"route\":{\"region\":\"eu\",\"target\":{\"host\":\"h" +
+                                                              std::to_string(i % 50) + "\",\"port\":" + std::to_string(8000 + i % 100) + "}}";
+            docs[i] = JSON("{\"id\":" + std::to_string(i) + ",\"method\":\"GET\"," + route + ",\"tags\":[\"a\",\"b\"]}");
+        }
+        long long sum = 0;
+        auto report = [&](const char *mode, const std::function<void()> &func) {
+            size_t before = allocation_count;
+            double ms = time_ms(func);
+            cout << "pointer: " << n << " " << mode << " " << ms << " " << allocation_count - before << endl;
+        };
+        report("chained-at", [&]() {
+            for (const JSON &doc: docs) {
+                try {
+                    sum += static_cast<long long>(doc.at("route").at("target").at("port"));
+                } catch (const std::out_of_range &) {
+                }
+            }
+        });
+        report("at_pointer", [&]() {
+            for (const JSON &doc: docs) {
+                try {
+                    sum += static_cast<long long>(doc.at_pointer("/route/target/port"));
+                } catch (const std::out_of_range &) {
+                }
+            }
+        });
+        JSONPointer port("/route/target/port");
+        report("compiled", [&]() {
+            for (const JSON &doc: docs) {
+                if (const JSON *value = port.find(doc)) sum += static_cast<long long>(*value);
+            }
+        });
+        if (sum == 0) cout << endl;
+    }
+}
+
+/* 宽记录的字段投影：每条记录有200个字段（数字、字符串、嵌套对象和数组），只取其中5个。
+ * 比较单线程parse_ndjson的完整解析和按投影解析，以及每批结果占用的分配次数 */
+static void bench_projection(const vector<size_t> &sizes_mb) {
+    cout << "projection: size(MB) records mode time(ms) allocations" << endl;
+    for (size_t mb: sizes_mb) {
+        string text;
+        size_t records = 0;
+        while (text.size() < (mb << 20)) {
+            text += "{\"ts\":" + std::to_string(1700000000 + records);
+            for (int f = 0; f < 200; ++f) {
+                string key = ",\"field_" + std::to_string(f) + "\":";
+                if (f % 4 == 0) text += key + std::to_string(records * f);
+                else if (f % 4 == 1) text += key + "\"value " + std::to_string(f) + " of record " + std::to_string(records) + "\"";
+                else if (f % 4 == 2) text += key + "{\"a\":" + std::to_string(f) + ",\"b\":[true,null,\"x\"]}";
+                else text += key + "[" + std::to_string(f) + ",2.5,\"y\"]";
+            }
+            text += ",\"user\":{\"id\":" + std::to_string(records % 1000) + ",\"name\":\"user name\"}}\n";
+            ++records;
+        }
+        size_t count = 0;
+        auto report = [&](const char *mode, const std::function<void()> &func) {
+            size_t before = allocation_count;
+            double ms = time_ms(func);
+            cout << "projection: " << mb << " " << records << " " << mode << " " << ms << " "
+                 << allocation_count - before << endl;
+        };
+        report("full", [&]() {
+            parse_ndjson(text, [&count](vector<JSON> &batch) { count += batch.size(); }, 1);
+        });
+        JSONProjection fields({"/ts", "/field_1", "/field_102", "/field_199", "/user/id"});
+        report("projected", [&]() {
+            parse_ndjson(text, fields, [&count](vector<JSON> &batch) { count += batch.size(); }, 1);
+        });
+        if (count == 0) cout << endl;
+    }
+}
+
+/* 并行基准使用的线程数：从first开始按2的幂递增，最后是硬件线程数 */
+static vector<unsigned> thread_counts(unsigned first) {
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    vector<unsigned> counts;
+    for (unsigned threads = first; threads < max_threads; threads *= 2) counts.push_back(threads);
+    if (max_threads >= first) counts.push_back(max_threads);
+    return counts;
+}
+
+/* 按行分隔的JSON：逐行构造JSON的单线程基准，以及parse_ndjson在1到N个线程下的吞吐量。N为硬件线程数 */
+static void bench_ndjson(const vector<size_t> &sizes_mb) {
+    cout << "ndjson: size(MB) records threads time(ms) MB/s" << endl;
+    for (size_t mb: sizes_mb) {
+        string text;
+        size_t records = 0;
+        while (text.size() < (mb << 20)) {
+            text += "{\"ts\":" + std::to_string(1700000000 + records) + ",\"level\":\"info\",\"msg\":\"request " +
+                    std::to_string(records) + " served\",\"latency\":" + std::to_string(records % 97) +
+                    ".5,\"tags\":[\"web\",\"eu\"]}\n";
+            ++records;
+        }
+        auto report = [&](const string &threads, double ms) {
+            cout << "ndjson: " << mb << " " << records << " " << threads << " " << ms << " "
+                 << static_cast<double>(text.size()) / (1 << 20) / (ms / 1000) << endl;
+        };
+        size_t count = 0;
+        report("lines", time_ms([&]() {
+            std::istringstream in(text);
+            string line;
+            while (std::getline(in, line)) {
+                JSON json(line);
+                count += json.size();
+            }
+        }));
+        for (unsigned threads: thread_counts(1)) {
+            report(std::to_string(threads), time_ms([&]() {
+                parse_ndjson(text, [&count](vector<JSON> &batch) { count += batch.size(); }, threads);
+            }));
+        }
+        if (count == 0) cout << endl;
+    }
+}
+
+/* 单个大数组的并行解析：单线程的JSON(str)与parse_parallel在1到N个线程下的耗时。N为硬件线程数 */
+static void bench_parallel(const vector<size_t> &sizes_mb) {
+    cout << "parallel: size(MB) threads time(ms) MB/s" << endl;
+    for (size_t mb: sizes_mb) {
+        string doc = make_nested_document(mb << 20, 1);
+        doc = doc.substr(doc.find('['), doc.size() - doc.find('[') - 1);     // 去掉外层对象，只保留记录数组
+        auto report = [&](const string &threads, double ms) {
+            cout << "parallel: " << mb << " " << threads << " " << ms << " "
+                 << static_cast<double>(doc.size()) / (1 << 20) / (ms / 1000) << endl;
+        };
+        size_t count = 0;
+        report("serial", time_ms([&]() { count += JSON(doc).size(); }));
+        for (unsigned threads: thread_counts(2))
+            report(std::to_string(threads), time_ms([&]() { count += JSON::parse_parallel(doc, threads).size(); }));
+        if (count == 0) cout << endl;
+    }
+}
+
+/* 大数组的并行序列化：dump与dump_parallel在2到N个线程下的耗时，以及dump_parallel直接写入输出流 */
+static void bench_parallel_dump(const vector<size_t> &sizes_mb) {
+    cout << "pdump: records indent threads time(ms) MB/s" << endl;
+    for (size_t mb: sizes_mb) {
+        size_t records = (mb << 20) / 64;
+        const JSON json(make_records(records));
+        for (int indent: {-1, 2}) {
+            size_t bytes = 0;
+            auto report = [&](const string &threads, double ms) {
+                cout << "pdump: " << records << " " << indent << " " << threads << " " << ms << " "
+                     << static_cast<double>(bytes) / (1 << 20) / (ms / 1000) << endl;
+            };
+            report("serial", time_ms([&]() { bytes = json.dump(indent).size(); }));
+            for (unsigned threads: thread_counts(2)) {
+                report(std::to_string(threads), time_ms([&]() { bytes = json.dump_parallel(indent, threads).size(); }));
+                std::ostringstream out;
+                report(std::to_string(threads) + "-ostream", time_ms([&]() { json.dump_parallel(out, indent, threads); }));
+            }
+        }
+    }
+}
+
+/* 按第mode种方式加载文件，返回顶层数组的元素个数 */
+static size_t load_file(int mode, const string &path) {
+    if (mode == 0) {
+        std::ifstream file(path);
+        JSON json{"[]"};
+        file >> json;
+        return json.size();
+    } else if (mode == 1) {
+        std::ifstream file(path, std::ios::binary);
+        std::ostringstream content;
+        content << file.rdbuf();
+        return JSON(content.str()).size();
+    } else if (mode == 2) {
+        return JSON::parse_file(path).size();
+    }
+    return JSONDocument::parse_file(path).root().size();
+}
+
+/* 从文件加载JSON：ifstream加operator>>、先读入字符串再解析、JSON::parse_file和JSONDocument::parse_file。
+ * Linux上每种方式在单独的子进程中执行，报告加载耗时和子进程的峰值常驻内存（ru_maxrss）；
+ * 其他平台在本进程中依次执行，只报告耗时 */
+static void bench_file(const vector<size_t> &sizes_mb) {
+    const char *modes[] = {"ifstream", "read-string", "parse_file", "document"};
+    const string path = "cppjson_bench_file.json";
+    cout << "file: size(MB) mode time(ms) peak-rss(MB)" << endl;
+    for (size_t mb: sizes_mb) {
+        {
+            string doc = "[";
+            for (size_t i = 0; doc.size() < (mb << 20); ++i) {
+                if (i) doc += ",";
+                doc += "{\"id\":" + std::to_string(i) + ",\"name\":\"item" + std::to_string(i) +
+                       "\",\"description\":\"reference data entry number " + std::to_string(i) + "\",\"ok\":true}";
+            }
+            doc += "]";
+            std::ofstream(path, std::ios::binary) << doc;
+        }
+#if defined(BENCH_LINUX)
+        malloc_trim(0);     // 子进程会继承父进程的常驻内存，先把生成文档用的内存还给系统
+        for (int mode = 0; mode < 4; ++mode) {
+            int pipe_fd[2];
+            if (pipe(pipe_fd) != 0) return;
+            pid_t pid = fork();
+            if (pid == 0) {
+                size_t size = 0;
+                double ms = time_ms([&]() { size = load_file(mode, path); });
+                if (write(pipe_fd[1], &ms, sizeof ms) != sizeof ms || size == 0) _exit(1);
+                _exit(0);
+            }
+            double ms = 0;
+            close(pipe_fd[1]);
+            bool ok = read(pipe_fd[0], &ms, sizeof ms) == sizeof ms;
+            close(pipe_fd[0]);
+            int status = 0;
+            struct rusage usage{};
+            wait4(pid, &status, 0, &usage);
+            if (!ok || status != 0) {
+                std::cerr << "file: " << modes[mode] << " failed" << endl;
+                continue;
+            }
+            cout << "file: " << mb << " " << modes[mode] << " " << ms << " "
+                 << static_cast<double>(usage.ru_maxrss) / 1024 << endl;
+        }
+#else
+        for (int mode = 0; mode < 4; ++mode) {
+            size_t size = 0;
+            double ms = time_ms([&]() { size = load_file(mode, path); });
+            if (size == 0) std::cerr << "file: " << modes[mode] << " failed" << endl;
+            else cout << "file: " << mb << " " << modes[mode] << " " << ms << " -" << endl;
+        }
+#endif
+        std::remove(path.c_str());
+    }
+}
+
+int main(int argc, char *argv[]) {
+    string name = argc > 1 ? argv[1] : "parse";
+    vector<size_t> sizes_mb;
+    for (int i = 2; i < argc; ++i) sizes_mb.push_back(std::stoul(argv[i]));
+    if (sizes_mb.empty()) sizes_mb = {1, 100};
+
+    if (name == "parse") {
+        bench_parse(sizes_mb);
+    } else if (name == "arena") {
+        bench_arena(sizes_mb);
+    } else if (name == "lookup") {
+        bench_lookup();
+    } else if (name == "scan") {
+        bench_scan(sizes_mb);
+    } else if (name == "sax") {
+        bench_sax(sizes_mb);
+    } else if (name == "dump") {
+        bench_dump(sizes_mb);
+    } else if (name == "msgpack") {
+        bench_msgpack(sizes_mb);
+    } else if (name == "equal") {
+        bench_equal(sizes_mb);
+    } else if (name == "move") {
+        bench_move(sizes_mb);
+    } else if (name == "snapshot") {
+        bench_snapshot(sizes_mb);
+    } else if (name == "footprint") {
+        bench_footprint(sizes_mb);
+    } else if (name == "accessors") {
+        bench_accessors(sizes_mb);
+    } else if (name == "tape") {
+        bench_tape(sizes_mb);
+    } else if (name == "keys") {
+        bench_keys(sizes_mb);
+    } else if (name == "struct") {
+        bench_struct(sizes_mb);
+    } else if (name == "lazy") {
+        bench_lazy(sizes_mb);
+    } else if (name == "parallel") {
+        bench_parallel(sizes_mb);
+    } else if (name == "pointer") {
+        bench_pointer(sizes_mb);
+    } else if (name == "validate") {
+        bench_validate(sizes_mb);
+    } else if (name == "numbers") {
+        bench_numbers(sizes_mb);
+    } else if (name == "projection") {
+        bench_projection(sizes_mb);
+    } else if (name == "pdump") {
+        bench_parallel_dump(sizes_mb);
+    } else if (name == "ndjson") {
+        bench_ndjson(sizes_mb);
+    } else if (name == "file") {
+        bench_file(sizes_mb);
+    } else {
+        std::cerr << "Unknown benchmark: " << name << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,312 +1,3024 @@
 #include "cppJSON.h"
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <array>
+
+#if __has_include(<sys/mman.h>)
+#define CPPJSON_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CPPJSON_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+/* 结构字符扫描：解析器在字符串内部和空白区域中按块跳跃，而不是逐个字符判断。
+ * 每种扫描都有标量、SSE2和AVX2三个实现（UTF-8校验需要SSSE3的查表指令），程序启动时按CPU支持的指令集选择一次 */
+
+static bool is_whitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/* 返回p[0, n)中第一个引号或反斜杠的下标，没有时返回n */
+static size_t find_quote_or_escape_scalar(const char *p, size_t n) {
+    size_t i = 0;
+    while (i < n && p[i] != '"' && p[i] != '\\') ++i;
+    return i;
+}
+
+/* 返回p[0, n)中第一个非空白字符的下标，没有时返回n */
+static size_t find_non_whitespace_scalar(const char *p, size_t n) {
+    size_t i = 0;
+    while (i < n && is_whitespace(p[i])) ++i;
+    return i;
+}
+
+/* 返回p[0, n)中第一个控制字符（小于0x20）或非ASCII字节的下标，没有时返回n。严格校验字符串时使用 */
+static size_t find_control_or_non_ascii_scalar(const char *p, size_t n) {
+    size_t i = 0;
+    while (i < n && static_cast<unsigned char>(p[i]) >= 0x20 && static_cast<unsigned char>(p[i]) < 0x80) ++i;
+    return i;
+}
+
+#ifdef CPPJSON_X86_SIMD
+
+static size_t find_quote_or_escape_sse2(const char *p, size_t n) {
+    const __m128i quote = _mm_set1_epi8('"'), escape = _mm_set1_epi8('\\');
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, escape)));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + find_quote_or_escape_scalar(p + i, n - i);
+}
+
+static size_t find_non_whitespace_sse2(const char *p, size_t n) {
+    const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+    const __m128i newline = _mm_set1_epi8('\n'), carriage = _mm_set1_epi8('\r');
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(block, newline), _mm_cmpeq_epi8(block, carriage)));
+        int mask = ~_mm_movemask_epi8(ws) & 0xFFFF;
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + find_non_whitespace_scalar(p + i, n - i);
+}
+
+// 按有符号数比较，非ASCII字节是负数，一次比较同时找出两种字节
+static size_t find_control_or_non_ascii_sse2(const char *p, size_t n) {
+    const __m128i space = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        int mask = _mm_movemask_epi8(_mm_cmplt_epi8(block, space));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + find_control_or_non_ascii_scalar(p + i, n - i);
+}
+
+// 256位寄存器的高半部分用过之后要先清零再进入SSE2的尾部处理，否则每次调用都要付出AVX与SSE切换的代价
+__attribute__((target("avx2")))
+static size_t find_quote_or_escape_avx2(const char *p, size_t n) {
+    const __m256i quote = _mm256_set1_epi8('"'), escape = _mm256_set1_epi8('\\');
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+        auto mask = static_cast<unsigned>(_mm256_movemask_epi8(
+                _mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, escape))));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    _mm256_zeroupper();
+    return i + find_quote_or_escape_sse2(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t find_non_whitespace_avx2(const char *p, size_t n) {
+    const __m256i space = _mm256_set1_epi8(' '), tab = _mm256_set1_epi8('\t');
+    const __m256i newline = _mm256_set1_epi8('\n'), carriage = _mm256_set1_epi8('\r');
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+        __m256i ws = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, tab)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(block, newline), _mm256_cmpeq_epi8(block, carriage)));
+        auto mask = ~static_cast<unsigned>(_mm256_movemask_epi8(ws));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    _mm256_zeroupper();
+    return i + find_non_whitespace_sse2(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t find_control_or_non_ascii_avx2(const char *p, size_t n) {
+    const __m256i space = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+        auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(space, block)));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    _mm256_zeroupper();
+    return i + find_control_or_non_ascii_sse2(p + i, n - i);
+}
+
+/* UTF-8的向量化校验（Keiser与Lemire的查表法）：每个字节与它前面的一个字节按高4位、低4位和后一字节的高4位
+ * 各查一次表，三个结果按位与之后非零就是错误（编码过长、代理项、大于U+10FFFF、缺少或多出后续字节）；
+ * 第3、4个后续字节另外由前面第2、3个字节判断。每个表项的一位对应一种错误 */
+namespace utf8_lookup {
+constexpr char TOO_SHORT = 1 << 0;      // 11______ 0_______ 或 11______ 11______
+constexpr char TOO_LONG = 1 << 1;       // 0_______ 10______
+constexpr char OVERLONG_3 = 1 << 2;     // 11100000 100_____
+constexpr char TOO_LARGE = 1 << 3;      // 11110100 1001____ 或 11110100 101_____ 或 11110101+ 10______
+constexpr char SURROGATE = 1 << 4;      // 11101101 101_____
+constexpr char OVERLONG_2 = 1 << 5;     // 1100000_ 10______
+constexpr char TOO_LARGE_1000 = 1 << 6; // 11110101+ 1000____
+constexpr char OVERLONG_4 = 1 << 6;     // 11110000 1000____
+constexpr char TWO_CONTS = char(1 << 7);    // 10______ 10______，第3、4个字节的这一位再与预期相消
+constexpr char CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+// 按前一字节的高4位
+constexpr char byte_1_high[16] = {
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT | OVERLONG_2, TOO_SHORT, TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4};
+
+// 按前一字节的低4位
+constexpr char byte_1_low[16] = {
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4, CARRY | OVERLONG_2, CARRY, CARRY,
+        CARRY | TOO_LARGE, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000};
+
+// 按本字节的高4位
+constexpr char byte_2_high[16] = {
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT};
+}
+
+// 一块16字节的错误位：prev是上一块，控制字符也记为错误
+__attribute__((target("ssse3")))
+static inline __m128i utf8_errors_ssse3(__m128i block, __m128i prev) {
+    using namespace utf8_lookup;
+    const __m128i low_nibble = _mm_set1_epi8(0x0F);
+    __m128i prev1 = _mm_alignr_epi8(block, prev, 15);
+    __m128i special = _mm_and_si128(
+            _mm_and_si128(
+                    _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(byte_1_high)),
+                                     _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble)),
+                    _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(byte_1_low)),
+                                     _mm_and_si128(prev1, low_nibble))),
+            _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(byte_2_high)),
+                             _mm_and_si128(_mm_srli_epi16(block, 4), low_nibble)));
+    __m128i third = _mm_subs_epu8(_mm_alignr_epi8(block, prev, 14), _mm_set1_epi8(char(0xE0 - 0x80)));
+    __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(block, prev, 13), _mm_set1_epi8(char(0xF0 - 0x80)));
+    __m128i expected = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(char(0x80)));
+    __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(block, _mm_set1_epi8(0x1F)), block);
+    return _mm_or_si128(_mm_xor_si128(expected, special), control);
+}
+
+/* 最后不足一块时只保留前r + 1个字节的错误：从utf8_tail_mask + 32 - (r + 1)处读出一块 */
+alignas(64) static const char utf8_tail_mask[64] = {
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+
+/* p[0, n)是否全部是合法的UTF-8并且没有控制字符。p之前的字节必须是ASCII（字符串中的片段总是从字符的边界开始），
+ * p[n]是片段之后的引号或反斜杠，从p开始可以读readable个字节。最后不足一块时，后面的字节可读就整块读入，
+ * 只保留到p[n]为止的错误，否则复制出来用空格补齐；结尾处不完整的字符都会因为后面是ASCII字节而被发现 */
+__attribute__((target("ssse3")))
+static bool valid_utf8_ssse3(const char *p, size_t n, size_t readable) {
+    __m128i prev = _mm_setzero_si128(), errors = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        errors = _mm_or_si128(errors, utf8_errors_ssse3(block, prev));
+        prev = block;
+    }
+    if (i + 16 <= readable) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i *>(utf8_tail_mask + 31 - (n - i)));
+        errors = _mm_or_si128(errors, _mm_and_si128(utf8_errors_ssse3(block, prev), mask));
+    } else {
+        char tail[16];
+        std::memset(tail, ' ', sizeof tail);
+        std::memcpy(tail, p + i, n - i);
+        errors = _mm_or_si128(errors, utf8_errors_ssse3(_mm_loadu_si128(reinterpret_cast<const __m128i *>(tail)), prev));
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(errors, _mm_setzero_si128())) == 0xFFFF;
+}
+
+// 把16项的表复制到两个128位通道中
+__attribute__((target("avx2")))
+static inline __m256i utf8_table_avx2(const char *entries) {
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(entries)));
+}
+
+// 与SSSE3的实现相同，跨128位通道取前面的字节时先把上一块的高半部分和本块的低半部分拼在一起
+__attribute__((target("avx2")))
+static inline __m256i utf8_errors_avx2(__m256i block, __m256i prev) {
+    using namespace utf8_lookup;
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    __m256i shifted = _mm256_permute2x128_si256(prev, block, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(block, shifted, 15);
+    __m256i special = _mm256_and_si256(
+            _mm256_and_si256(
+                    _mm256_shuffle_epi8(utf8_table_avx2(byte_1_high), _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble)),
+                    _mm256_shuffle_epi8(utf8_table_avx2(byte_1_low), _mm256_and_si256(prev1, low_nibble))),
+            _mm256_shuffle_epi8(utf8_table_avx2(byte_2_high), _mm256_and_si256(_mm256_srli_epi16(block, 4), low_nibble)));
+    __m256i third = _mm256_subs_epu8(_mm256_alignr_epi8(block, shifted, 14), _mm256_set1_epi8(char(0xE0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(_mm256_alignr_epi8(block, shifted, 13), _mm256_set1_epi8(char(0xF0 - 0x80)));
+    __m256i expected = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(char(0x80)));
+    __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(block, _mm256_set1_epi8(0x1F)), block);
+    return _mm256_or_si256(_mm256_xor_si256(expected, special), control);
+}
+
+__attribute__((target("avx2")))
+static bool valid_utf8_avx2(const char *p, size_t n, size_t readable) {
+    __m256i prev = _mm256_setzero_si256(), errors = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+        errors = _mm256_or_si256(errors, utf8_errors_avx2(block, prev));
+        prev = block;
+    }
+    if (i + 32 <= readable) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+        __m256i mask = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(utf8_tail_mask + 31 - (n - i)));
+        errors = _mm256_or_si256(errors, _mm256_and_si256(utf8_errors_avx2(block, prev), mask));
+    } else {
+        char tail[32];
+        std::memset(tail, ' ', sizeof tail);
+        std::memcpy(tail, p + i, n - i);
+        errors = _mm256_or_si256(errors,
+                                 utf8_errors_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(tail)), prev));
+    }
+    bool valid = _mm256_testz_si256(errors, errors);
+    _mm256_zeroupper();
+    return valid;
+}
+
+#endif
+
+/* 运行时选择的扫描函数 */
+struct ScanKernels {
+    size_t (*find_quote_or_escape)(const char *, size_t);
+
+    size_t (*find_non_whitespace)(const char *, size_t);
+
+    size_t (*find_control_or_non_ascii)(const char *, size_t);
+
+    bool (*valid_utf8)(const char *, size_t, size_t);     // 没有SSSE3时为空，逐个字符校验
+};
+
+static ScanKernels select_scan_kernels() {
+#ifdef CPPJSON_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return {find_quote_or_escape_avx2, find_non_whitespace_avx2, find_control_or_non_ascii_avx2, valid_utf8_avx2};
+    if (__builtin_cpu_supports("ssse3"))
+        return {find_quote_or_escape_sse2, find_non_whitespace_sse2, find_control_or_non_ascii_sse2, valid_utf8_ssse3};
+    if (__builtin_cpu_supports("sse2"))
+        return {find_quote_or_escape_sse2, find_non_whitespace_sse2, find_control_or_non_ascii_sse2, nullptr};
+#endif
+    return {find_quote_or_escape_scalar, find_non_whitespace_scalar, find_control_or_non_ascii_scalar, nullptr};
+}
+
+/* 使用函数内的静态变量，保证其他编译单元的静态初始化中解析JSON时扫描函数已经选好 */
+static const ScanKernels &scan_kernels() {
+    static const ScanKernels kernels = select_scan_kernels();
+    return kernels;
+}
+
+/* 解析器的输入是string_view，但要求str末尾之后的一个字节可读且为'\0'：std::string和JSONMappedFile都满足。
+ * 各个分支读到'\0'都会停止，因此按下标读取字符前不检查是否越界，读取时通过data()绕过string_view的下标检查 */
+
+/* 跳过JSON空白字符（空格、制表符、换行、回车）。紧凑的JSON中值之间通常没有或只有一个空白字符，
+ * 只有遇到连续的空白（如缩进）时才调用向量化扫描 */
+static void skip_whitespace(std::string_view str, size_t &pos) {
+    if (!is_whitespace(str.data()[pos])) return;
+    ++pos;
+    if (!is_whitespace(str.data()[pos])) return;
+    if (pos < str.size()) pos += scan_kernels().find_non_whitespace(str.data() + pos, str.size() - pos);
+}
+
+/* 允许的最大嵌套层数。解析是递归进行的，任何模式下都限制层数，以免恶意的输入耗尽调用栈 */
+static constexpr size_t MAX_DEPTH = 1024;
 
-/* 分析json值的类型，返回值为指向用json值构造对应的对象的shared_ptr */
-shared_ptr<JSON> parse_value(const string &str, size_t &pos) {
-    while (isspace(str[pos]) || str[pos] == ',') ++pos;
+/* 记号扫描的状态：还原转义字符的缓冲区、是否按RFC 8259严格校验、当前的嵌套层数，以及遇到的第一个错误。
+ * 扫描和解析函数出错时只记录错误并返回，调用者检查failed()后逐层返回，需要异常的入口最后再统一抛出 */
+struct ScanState {
+    std::pmr::string buffer;    // 含转义字符的字符串在这里还原
+    bool strict = false;
+    size_t depth = 0;
+    JSONParseError error;
+
+    // 进入pos处的数组或对象，超过MAX_DEPTH层时记录错误并返回false
+    bool enter(size_t pos) {
+        return ++depth <= MAX_DEPTH || fail(JSONErrorCode::TOO_DEEP, pos);
+    }
+
+    bool failed() const { return error.code != JSONErrorCode::NONE; }
+
+    // 记录错误，总是返回false，便于写成return state.fail(...)
+    bool fail(JSONErrorCode code, size_t offset) {
+        if (!failed()) error = {code, offset};
+        return false;
+    }
+
+    // 有错误时抛出std::runtime_error
+    void check() const {
+        if (failed()) throw std::runtime_error(error.message());
+    }
+};
+
+/* 将一个Unicode码点按UTF-8编码追加到out末尾 */
+static void append_utf8(std::pmr::string &out, unsigned int cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+/* 解析\u后的4位十六进制数，不合法时返回false */
+static bool parse_hex4(std::string_view str, size_t pos, unsigned int &cp) {
+    if (pos + 4 > str.size()) return false;
+    cp = 0;
+    for (size_t i = pos; i < pos + 4; ++i) {
+        char c = str.data()[i];
+        cp <<= 4;
+        if (c >= '0' && c <= '9') cp |= c - '0';
+        else if (c >= 'a' && c <= 'f') cp |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') cp |= c - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
+
+/* 校验p处的一个多字节UTF-8字符（不超过n字节），返回其长度，不合法（包括过长编码和代理项）时返回0 */
+static size_t utf8_sequence_length(const unsigned char *p, size_t n) {
+    auto continuation = [p, n](size_t i, unsigned char low, unsigned char high) {
+        return i < n && p[i] >= low && p[i] <= high;
+    };
+    unsigned char c = p[0];
+    if (c >= 0xC2 && c <= 0xDF) return continuation(1, 0x80, 0xBF) ? 2 : 0;
+    if (c >= 0xE0 && c <= 0xEF) {
+        unsigned char low = c == 0xE0 ? 0xA0 : 0x80, high = c == 0xED ? 0x9F : 0xBF;
+        return continuation(1, low, high) && continuation(2, 0x80, 0xBF) ? 3 : 0;
+    }
+    if (c >= 0xF0 && c <= 0xF4) {
+        unsigned char low = c == 0xF0 ? 0x90 : 0x80, high = c == 0xF4 ? 0x8F : 0xBF;
+        return continuation(1, low, high) && continuation(2, 0x80, 0xBF) && continuation(3, 0x80, 0xBF) ? 4 : 0;
+    }
+    return 0;
+}
+
+/* 严格校验字符串中str[begin, end)这一段不含转义字符的原始字节：不能有控制字符，非ASCII字节必须是合法的UTF-8。
+ * 较长的片段整段向量化校验，只有校验失败时才逐个字符找出错误的位置。键和短字符串直接逐字节检查，
+ * 非ASCII字符通常连续出现，逐个校验到下一个ASCII字符再回到扫描。str之后的'\0'也可以读 */
+static bool check_string_bytes(std::string_view str, size_t begin, size_t end, ScanState &state) {
+    auto data = reinterpret_cast<const unsigned char *>(str.data());
+    if (end - begin >= 16 && scan_kernels().valid_utf8 &&
+        scan_kernels().valid_utf8(str.data() + begin, end - begin, str.size() + 1 - begin))
+        return true;
+    for (size_t i = begin;;) {
+        if (end - i < 16)
+            i += find_control_or_non_ascii_scalar(str.data() + i, end - i);
+        else
+            i += scan_kernels().find_control_or_non_ascii(str.data() + i, end - i);
+        if (i == end) return true;
+        if (data[i] < 0x20) return state.fail(JSONErrorCode::CONTROL_CHARACTER, i);
+        do {
+            size_t len = utf8_sequence_length(data + i, end - i);
+            if (!len) return state.fail(JSONErrorCode::INVALID_UTF8, i);
+            i += len;
+        } while (i < end && data[i] >= 0x80);
+    }
+}
+
+/* 扫描pos处（指向左引号）的JSON字符串，结束后pos指向右引号之后。没有转义字符时直接返回指向str的视图，
+ * 否则把转义后的内容写入state.buffer并返回指向它的视图。出错时记录在state中并返回空视图。
+ * 严格模式下还校验原始字节（见check_string_bytes），并且\u代理项必须成对出现 */
+static std::string_view scan_string(std::string_view str, size_t &pos, ScanState &state) {
+    size_t quote = pos, start = ++pos;
+    if (pos < str.size()) pos += scan_kernels().find_quote_or_escape(str.data() + pos, str.size() - pos);
+    if (pos >= str.size()) {
+        state.fail(JSONErrorCode::UNTERMINATED_STRING, quote);
+        return {};
+    }
+    if (state.strict && !check_string_bytes(str, start, pos, state)) return {};
+    if (str.data()[pos] == '"') {
+        ++pos;
+        return {str.data() + start, pos - 1 - start};
+    }
+    std::pmr::string &buffer = state.buffer;
+    buffer.assign(str.data() + start, pos - start);
+    while (true) {
+        char c = str.data()[pos + 1];
+        pos += 2;
+        switch (c) {
+            case '"': buffer.push_back('"'); break;
+            case '\\': buffer.push_back('\\'); break;
+            case '/': buffer.push_back('/'); break;
+            case 'b': buffer.push_back('\b'); break;
+            case 'f': buffer.push_back('\f'); break;
+            case 'n': buffer.push_back('\n'); break;
+            case 'r': buffer.push_back('\r'); break;
+            case 't': buffer.push_back('\t'); break;
+            case 'u': {
+                unsigned int cp;
+                if (!parse_hex4(str, pos, cp)) {
+                    state.fail(JSONErrorCode::INVALID_UNICODE_ESCAPE, pos - 2);
+                    return {};
+                }
+                pos += 4;
+                // 代理对：高代理后紧跟\u低代理
+                unsigned int low;
+                if (cp >= 0xD800 && cp <= 0xDBFF && str.data()[pos] == '\\' && str.data()[pos + 1] == 'u' &&
+                    parse_hex4(str, pos + 2, low) && low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                } else if (state.strict && cp >= 0xD800 && cp <= 0xDFFF) {
+                    state.fail(JSONErrorCode::INVALID_UNICODE_ESCAPE, pos - 6);
+                    return {};
+                }
+                append_utf8(buffer, cp);
+                break;
+            }
+            default:
+                state.fail(JSONErrorCode::INVALID_ESCAPE, pos - 2);
+                return {};
+        }
+        // 没有转义字符的片段整体追加
+        start = pos;
+        if (pos < str.size()) pos += scan_kernels().find_quote_or_escape(str.data() + pos, str.size() - pos);
+        if (pos >= str.size()) {
+            state.fail(JSONErrorCode::UNTERMINATED_STRING, quote);
+            return {};
+        }
+        if (state.strict && !check_string_bytes(str, start, pos, state)) return {};
+        buffer.append(str.data() + start, pos - start);
+        if (str.data()[pos] == '"') break;
+    }
+    ++pos;
+    return buffer;
+}
+
+/* 跳过字符串的其余部分（pos指向左引号之后），结束后pos指向右引号之后，字符串没有结束时指向末尾。不还原转义字符 */
+static void skip_string(std::string_view str, size_t &pos) {
+    while (pos < str.size()) {
+        pos += scan_kernels().find_quote_or_escape(str.data() + pos, str.size() - pos);
+        if (pos >= str.size() || str.data()[pos] == '"') break;
+        pos += 2;   // 跳过转义字符
+    }
+    pos = std::min(pos + 1, str.size());
+}
+
+/* 跳过pos处（指向左括号）的数组或对象，结束后pos指向右括号之后。只匹配括号和字符串，不解析其中的值，
+ * 因此只能用于已经校验过、或之后还会被完整解析的文本 */
+static void skip_container(std::string_view str, size_t &pos) {
+    size_t depth = 0;
+    do {
+        char c = str.data()[pos++];
+        if (c == '"') {
+            skip_string(str, pos);
+        } else if (c == '[' || c == '{') {
+            ++depth;
+        } else if (c == ']' || c == '}') {
+            --depth;
+        }
+    } while (depth && pos < str.size());
+}
+
+/* 跳过pos处的值而不构造节点：字符串和容器只匹配引号和括号，数字和字面量扫描到下一个分隔符为止 */
+static bool skip_value(std::string_view str, size_t &pos, ScanState &state) {
+    skip_whitespace(str, pos);
+    char c = str.data()[pos];
+    if (c == '"') {
+        skip_string(str, ++pos);
+    } else if (c == '[' || c == '{') {
+        skip_container(str, pos);
+    } else {
+        size_t start = pos;
+        while (pos < str.size() && !is_whitespace(str.data()[pos]) && str.data()[pos] != ',' &&
+               str.data()[pos] != ']' && str.data()[pos] != '}')
+            ++pos;
+        if (pos == start) return state.fail(JSONErrorCode::INVALID_VALUE, pos);
+    }
+    return true;
+}
+
+/* 顶层数组中连续的一段元素：从offset处开始的count个元素，第一个元素的下标为first */
+struct ArrayPartition {
+    size_t offset;
+    size_t first;
+    size_t count;
+};
+
+/* 结构预扫描：pos指向顶层数组的'['，每隔约chunk字节在元素的边界处分段，结束后pos指向']'之后。
+ * 只检查元素之间的分隔符，元素本身由各段的解析负责校验 */
+static vector<ArrayPartition> partition_array(std::string_view str, size_t &pos, size_t chunk) {
+    vector<ArrayPartition> parts;
+    ++pos;
+    skip_whitespace(str, pos);
+    if (str.data()[pos] == ']') {
+        ++pos;
+        return parts;
+    }
+    for (size_t index = 0;; ++index) {
+        skip_whitespace(str, pos);
+        if (parts.empty() || pos - parts.back().offset >= chunk) parts.push_back({pos, index, 0});
+        ++parts.back().count;
+        char c = str.data()[pos];
+        if (c == '[' || c == '{') {
+            skip_container(str, pos);
+        } else if (c == '"') {
+            skip_string(str, ++pos);
+        } else {
+            while (pos < str.size() && !is_whitespace(str.data()[pos]) && str.data()[pos] != ',' &&
+                   str.data()[pos] != ']')
+                ++pos;
+        }
+        skip_whitespace(str, pos);
+        if (str.data()[pos] == ']') {
+            ++pos;
+            return parts;
+        }
+        if (str.data()[pos] != ',') throw std::runtime_error("Expected ',' or ']' in JSON array");
+        ++pos;
+    }
+}
+
+/* 判断字符是否为十进制数字 */
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/* 判断str的pos处是否为字面量literal */
+static bool match_literal(std::string_view str, size_t pos, const char *literal, size_t len) {
+    return str.compare(pos, len, literal, len) == 0;
+}
+
+/* scan_number解析出的数字种类 */
+enum class NumberKind { SIGNED, UNSIGNED, FLOAT };
+
+/* 扫描pos处的数字，结束后pos指向数字之后。整数保存在int_value中，大于INT64_MAX的整数按位保存在int_value中并返回
+ * UNSIGNED；浮点数和超出64位整数范围的整数保存在float_value中并返回FLOAT。直接用std::from_chars在原文上转换，
+ * 不分配内存。出错时记录在state中。数字按RFC 8259的语法检查：没有'+'号，整数部分不以0开头，
+ * 小数点和指数之后必须有数字 */
+static NumberKind scan_number(std::string_view str, size_t &pos, long long &int_value, double &float_value,
+                              ScanState &state) {
+    size_t start = pos;
+    bool is_float = false;
+    if (str.data()[pos] == '-') ++pos;
+    size_t digits = pos;
+    while (is_digit(str.data()[pos])) ++pos;
+    bool malformed = pos == digits || (str.data()[digits] == '0' && pos - digits > 1);
+    if (str.data()[pos] == '.') {
+        is_float = true;
+        digits = ++pos;
+        while (is_digit(str.data()[pos])) ++pos;
+        malformed |= pos == digits;
+    }
+    if (str.data()[pos] == 'e' || str.data()[pos] == 'E') {
+        is_float = true;
+        ++pos;
+        if (str.data()[pos] == '-' || str.data()[pos] == '+') ++pos;
+        digits = pos;
+        while (is_digit(str.data()[pos])) ++pos;
+        malformed |= pos == digits;
+    }
+    if (malformed) {
+        state.fail(JSONErrorCode::INVALID_NUMBER, start);
+        return NumberKind::SIGNED;
+    }
+    const char *first = str.data() + start, *last = str.data() + pos;
+    if (!is_float) {
+        auto result = std::from_chars(first, last, int_value);
+        if (result.ec == std::errc() && result.ptr == last) return NumberKind::SIGNED;
+        if (result.ec != std::errc::result_out_of_range) {
+            state.fail(JSONErrorCode::INVALID_NUMBER, start);
+            return NumberKind::SIGNED;
+        }
+        unsigned long long value;
+        if (*first != '-' && std::from_chars(first, last, value).ec == std::errc()) {
+            int_value = static_cast<long long>(value);
+            return NumberKind::UNSIGNED;
+        }
+        // 超出64位整数范围，按浮点数解析
+    }
+    auto result = std::from_chars(first, last, float_value);
+    if (result.ec == std::errc::result_out_of_range) {
+        // from_chars出错时不写入结果。下溢的数字是合法的JSON，由strtod得到0或非规格化数，只有上溢才报错
+        float_value = std::strtod(string(first, last).c_str(), nullptr);
+        if (std::isinf(float_value)) state.fail(JSONErrorCode::NUMBER_OUT_OF_RANGE, start);
+    } else if (result.ec != std::errc() || result.ptr != last) {
+        state.fail(JSONErrorCode::INVALID_NUMBER, start);
+    }
+    return NumberKind::FLOAT;
+}
+
+/* 将带引号的JSON字符串追加到out末尾，对引号、反斜杠和控制字符进行转义 */
+static void append_string(string &out, std::string_view value) {
+    static const char hex[] = "0123456789abcdef";
+    out.push_back('"');
+    size_t start = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        auto c = static_cast<unsigned char>(value[i]);
+        if (c != '"' && c != '\\' && c >= 0x20) continue;
+        out.append(value.data() + start, i - start);
+        start = i + 1;
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default: {
+                const char escape[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                out.append(escape, sizeof escape);
+            }
+        }
+    }
+    out.append(value.data() + start, value.size() - start);
+    out.push_back('"');
+}
+
+/* 输出带引号的JSON字符串，转义规则与append_string相同 */
+static void write_string(ostream &out, std::string_view value) {
+    string buffer;
+    append_string(buffer, value);
+    out << buffer;
+}
+
+/* 从resource中分配并构造数组或对象的存储 */
+template<typename T>
+static T *new_block(std::pmr::memory_resource *resource) {
+    return new(resource->allocate(sizeof(T), alignof(T))) T(resource);
+}
+
+/* 减少存储的引用计数，最后一个引用释放时析构存储并归还给分配它的内存资源 */
+template<typename T>
+static void unref_block(T *block) noexcept {
+    if (block && --block->refs == 0) {
+        std::pmr::memory_resource *resource = block->resource;
+        block->~T();
+        resource->deallocate(block, sizeof(T), alignof(T));
+    }
+}
+
+/* 解析时使用的临时栈：容器的元素依次压入栈中，容器结束时按元素的实际个数一次分配存储并把元素移过去。
+ * 存储没有多余的容量，也不会因为反复扩容而多次分配。嵌套的容器共用同一个栈。
+ * 出错时栈中可能残留未完成的元素，再次使用前调用reset。键字典在reset后保留，同一个栈依次解析的多个值
+ * （例如NDJSON的各行）共用其中的键 */
+struct JSON::ParseStack : ScanState {
+    vector<JSON> values;
+    vector<JSONObject::Member> members;
+    bool borrow_strings = false;
+    bool keep_number_text = false;              // 为true时数字节点保留输入中的原文
+    const LazySource *lazy_source = nullptr;    // 不为空时嵌套的数组和对象只记录位置，不解析
+    KeyDictionary keys;
+
+    // 把扫描到的字符串存入json。允许借用时，不含转义字符（不在buffer中）的长字符串直接指向输入
+    void store_string(JSON &json, std::string_view value, std::pmr::memory_resource *resource) const {
+        if (borrow_strings && value.size() > SHORT_STRING_CAPACITY && value.data() != buffer.data() &&
+            value.size() <= std::numeric_limits<uint32_t>::max())
+            json.borrow_string(value);
+        else
+            json.set_string(value, resource);
+    }
+
+    // 把扫描到的键存入json。借用字符串时键的存储由文档持有，不经过键字典
+    void store_key(JSON &json, std::string_view value, std::pmr::memory_resource *resource) {
+        if (borrow_strings)
+            store_string(json, value, resource);
+        else
+            keys.store(json, value, resource);
+    }
+
+    // 解析数组的元素或对象的值
+    JSON element(std::string_view str, size_t &pos, std::pmr::memory_resource *resource) {
+        if (lazy_source) {
+            skip_whitespace(str, pos);
+            char c = str.data()[pos];
+            if (c == '[' || c == '{') {
+                JSON json;
+                json.defer(c == '[' ? JSON_ARRAY_TYPE : JSON_OBJECT_TYPE, lazy_source, pos);
+                skip_container(str, pos);
+                return json;
+            }
+        }
+        return parse(str, pos, resource, *this);
+    }
+
+    void reset() {
+        values.clear();
+        members.clear();
+        depth = 0;
+        error = JSONParseError();
+    }
+};
+
+JSON parse_value(const string &str, size_t &pos, std::pmr::memory_resource *resource) {
+    JSON::ParseStack stack;
+    JSON json = JSON::parse(str, pos, resource, stack);
+    stack.check();
+    return json;
+}
+
+/* 分析json值的类型，返回对应的JSON值。
+ * 解析从pos处开始单遍进行，嵌套的数组和对象直接在原字符串上递归解析，结束后pos指向该值之后的字符。
+ * 出错时把错误记录在stack中并立即返回，返回的值没有意义 */
+JSON JSON::parse(std::string_view str, size_t &pos, std::pmr::memory_resource *resource, ParseStack &stack) {
+    skip_whitespace(str, pos);
+    JSON json;
     // 值为string类型
-    if (str[pos] == '"') {
-        size_t start = pos + 1;
-        size_t end = str.find('"', start);
-        string value = str.substr(start, end - start);
-        pos = end + 1;
-        return make_shared<JSON>(JSON::Value(std::in_place_type<StringValue>, value));
+    if (str.data()[pos] == '"') {
+        std::string_view value = scan_string(str, pos, stack);
+        if (!stack.failed()) stack.store_string(json, value, resource);
     }
     // 值为数字（整数或浮点数）类型
-    else if (isdigit(str[pos]) || str[pos] == '-' || str[pos] == '+') {
+    else if (is_digit(str.data()[pos]) || str.data()[pos] == '-' || str.data()[pos] == '+') {
         size_t start = pos;
-        while (isdigit(str[pos]) || str[pos] == '.') ++pos;
-        string value = str.substr(start, pos - start);
-        if (value.find('.') == string::npos)
-            return make_shared<JSON>(JSON::Value(std::in_place_type<IntValue>, stoll(value)));
-        else
-            return make_shared<JSON>(JSON::Value(std::in_place_type<FloatValue>, stold(value)));
+        long long int_value;
+        double float_value;
+        NumberKind kind = scan_number(str, pos, int_value, float_value, stack);
+        if (kind != NumberKind::FLOAT) {
+            json.type = INT_TYPE;
+            json.int_value = int_value;
+            if (kind == NumberKind::UNSIGNED) json.short_size = UNSIGNED_INTEGER;
+        } else {
+            json.type = FLOAT_TYPE;
+            json.float_value = float_value;
+        }
+        if (stack.keep_number_text && !stack.failed())
+            json.keep_number_text(str.substr(start, pos - start), resource);
     }
     // 值为布尔类型
-    else if (str[pos] == 't' || str[pos] == 'f') {
-        if (str[pos] == 't') {
-            pos += 4;
-            return make_shared<JSON>(JSON::Value(std::in_place_type<BoolValue>, true));
-        } else if (str[pos] == 'f') {
-            pos += 5;
-            return make_shared<JSON>(JSON::Value(std::in_place_type<BoolValue>, false));
+    else if (match_literal(str, pos, "true", 4)) {
+        pos += 4;
+        json.type = BOOL_TYPE;
+        json.bool_value = true;
+    } else if (match_literal(str, pos, "false", 5)) {
+        pos += 5;
+        json.type = BOOL_TYPE;
+        json.bool_value = false;
+    }
+    // 值为null
+    else if (match_literal(str, pos, "null", 4)) {
+        pos += 4;
+    }
+    // 值为json数组类型，空数组不分配存储
+    else if (str.data()[pos] == '[') {
+        json = empty_container(JSON_ARRAY_TYPE);
+        if (!stack.enter(pos)) return json;
+        ++pos;
+        skip_whitespace(str, pos);
+        if (str.data()[pos] == ']') {
+            ++pos;
+            --stack.depth;
+            return json;
+        }
+        size_t start = stack.values.size();
+        while (true) {
+            stack.values.push_back(stack.element(str, pos, resource));
+            if (stack.failed()) return json;
+            skip_whitespace(str, pos);
+            if (str.data()[pos] == ',') {
+                ++pos;
+            } else if (str.data()[pos] == ']') {
+                ++pos;
+                break;
+            } else {
+                stack.fail(JSONErrorCode::EXPECTED_ARRAY_SEPARATOR, pos);
+                return json;
+            }
+        }
+        json.array_data = new_block<JSONArray>(resource);
+        json.array_data->values.assign(std::make_move_iterator(stack.values.begin() + start),
+                                       std::make_move_iterator(stack.values.end()));
+        stack.values.resize(start);
+        --stack.depth;
+    }
+    // 值为json对象类型，空对象不分配存储
+    else if (str.data()[pos] == '{') {
+        json = empty_container(JSON_OBJECT_TYPE);
+        if (!stack.enter(pos)) return json;
+        ++pos;
+        skip_whitespace(str, pos);
+        if (str.data()[pos] == '}') {
+            ++pos;
+            --stack.depth;
+            return json;
+        }
+        size_t start = stack.members.size();
+        while (true) {
+            skip_whitespace(str, pos);
+            if (str.data()[pos] != '"') {
+                stack.fail(JSONErrorCode::EXPECTED_KEY, pos);
+                return json;
+            }
+            std::string_view key_value = scan_string(str, pos, stack);
+            if (stack.failed()) return json;
+            JSON key;
+            stack.store_key(key, key_value, resource);
+            skip_whitespace(str, pos);
+            if (str.data()[pos] != ':') {
+                stack.fail(JSONErrorCode::EXPECTED_COLON, pos);
+                return json;
+            }
+            ++pos;
+            JSON value = stack.element(str, pos, resource);    // 嵌套的对象也会压栈，先解析完值再入栈
+            if (stack.failed()) return json;
+            stack.members.push_back({std::move(key), std::move(value)});
+            skip_whitespace(str, pos);
+            if (str.data()[pos] == ',') {
+                ++pos;
+            } else if (str.data()[pos] == '}') {
+                ++pos;
+                break;
+            } else {
+                stack.fail(JSONErrorCode::EXPECTED_OBJECT_SEPARATOR, pos);
+                return json;
+            }
+        }
+        json.object_data = new_block<JSONObject>(resource);
+        json.object_data->members.assign(std::make_move_iterator(stack.members.begin() + start),
+                                         std::make_move_iterator(stack.members.end()));
+        json.object_data->rebuild_index();
+        stack.members.resize(start);
+        --stack.depth;
+    } else {
+        stack.fail(JSONErrorCode::INVALID_VALUE, pos);
+    }
+    return json;
+}
+
+/* 解析pos处的值并把对应的事件交给handler，与parse_value共用同一套记号扫描函数。
+ * state.buffer用于保存含转义字符的字符串，在整个解析过程中复用。handler中止解析或出错时返回false，
+ * 出错时错误记录在state中。Handler是JSONHandler或者有同样成员函数的类，后者的调用不经过虚函数 */
+template<typename Handler>
+static bool sax_value(std::string_view str, size_t &pos, Handler &handler, ScanState &state) {
+    skip_whitespace(str, pos);
+    char c = str.data()[pos];
+    if (c == '"') {
+        std::string_view value = scan_string(str, pos, state);
+        return !state.failed() && handler.string_value(value);
+    } else if (is_digit(c) || c == '-' || c == '+') {
+        long long int_value;
+        double float_value;
+        NumberKind kind = scan_number(str, pos, int_value, float_value, state);
+        if (state.failed()) return false;
+        if (kind == NumberKind::UNSIGNED) return handler.uint64_value(static_cast<unsigned long long>(int_value));
+        return kind == NumberKind::FLOAT ? handler.double_value(float_value) : handler.int64_value(int_value);
+    } else if (match_literal(str, pos, "true", 4)) {
+        pos += 4;
+        return handler.bool_value(true);
+    } else if (match_literal(str, pos, "false", 5)) {
+        pos += 5;
+        return handler.bool_value(false);
+    } else if (match_literal(str, pos, "null", 4)) {
+        pos += 4;
+        return handler.null_value();
+    } else if (c == '[') {
+        if (!state.enter(pos) || !handler.start_array()) return false;
+        ++pos;
+        skip_whitespace(str, pos);
+        if (str.data()[pos] != ']') {
+            while (true) {
+                if (!sax_value(str, pos, handler, state)) return false;
+                skip_whitespace(str, pos);
+                if (str.data()[pos] == ']') break;
+                if (str.data()[pos] != ',') return state.fail(JSONErrorCode::EXPECTED_ARRAY_SEPARATOR, pos);
+                ++pos;
+            }
+        }
+        ++pos;
+        --state.depth;
+        return handler.end_array();
+    } else if (c == '{') {
+        if (!state.enter(pos) || !handler.start_object()) return false;
+        ++pos;
+        skip_whitespace(str, pos);
+        if (str.data()[pos] != '}') {
+            while (true) {
+                skip_whitespace(str, pos);
+                if (str.data()[pos] != '"') return state.fail(JSONErrorCode::EXPECTED_KEY, pos);
+                std::string_view key = scan_string(str, pos, state);
+                if (state.failed() || !handler.key(key)) return false;
+                skip_whitespace(str, pos);
+                if (str.data()[pos] != ':') return state.fail(JSONErrorCode::EXPECTED_COLON, pos);
+                ++pos;
+                if (!sax_value(str, pos, handler, state)) return false;
+                skip_whitespace(str, pos);
+                if (str.data()[pos] == '}') break;
+                if (str.data()[pos] != ',') return state.fail(JSONErrorCode::EXPECTED_OBJECT_SEPARATOR, pos);
+                ++pos;
+            }
+        }
+        ++pos;
+        --state.depth;
+        return handler.end_object();
+    }
+    return state.fail(JSONErrorCode::INVALID_VALUE, pos);
+}
+
+bool parse_sax(const string &str, JSONHandler &handler) {
+    ScanState state;
+    size_t pos = 0;
+    if (!sax_value(str, pos, handler, state)) {
+        state.check();
+        return false;
+    }
+    skip_whitespace(str, pos);
+    if (pos != str.size()) throw std::runtime_error("Unexpected characters after JSON value");
+    return true;
+}
+
+
+static_assert(sizeof(JSON) == 16, "A JSON node is expected to take 16 bytes");
+
+JSON::JSON(const string &str) : JSON(str, std::pmr::get_default_resource()) {}
+
+JSON::JSON(const string &str, std::pmr::memory_resource *resource) : JSON() {
+    JSON json = parse_text(str, resource, false);
+    steal(json);
+}
+
+JSON JSON::parse_text(std::string_view str, std::pmr::memory_resource *resource, bool borrow_strings) {
+    size_t pos = 0;
+    skip_whitespace(str, pos);
+    if (str.data()[pos] != '{' && str.data()[pos] != '[') throw std::runtime_error("Unqualified JSON string");
+    ParseStack stack;
+    stack.borrow_strings = borrow_strings;
+    JSON json = parse(str, pos, resource, stack);
+    stack.check();
+    skip_whitespace(str, pos);
+    if (pos != str.size()) throw std::runtime_error("Unexpected characters after JSON value");
+    return json;
+}
+
+/* 与JSON(str)使用同一个解析函数，严格模式只增加字符串字节（控制字符和UTF-8编码）的向量化校验和\u代理对的检查。
+ * 错误沿调用链逐层返回，整个过程不抛出异常 */
+JSONParseResult JSON::try_parse(const string &str) {
+    ParseStack stack;
+    stack.strict = true;
+    size_t pos = 0;
+    JSON json = parse(str, pos, std::pmr::get_default_resource(), stack);
+    if (!stack.failed()) {
+        skip_whitespace(str, pos);
+        if (pos != str.size()) stack.fail(JSONErrorCode::TRAILING_CHARACTERS, pos);
+    }
+    if (stack.failed()) return stack.error;
+    return JSONParseResult(std::move(json));
+}
+
+JSON JSON::parse_preserving_numbers(const string &str) {
+    size_t pos = 0;
+    skip_whitespace(str, pos);
+    if (str.data()[pos] != '{' && str.data()[pos] != '[') throw std::runtime_error("Unqualified JSON string");
+    ParseStack stack;
+    stack.keep_number_text = true;
+    JSON json = parse(str, pos, std::pmr::get_default_resource(), stack);
+    stack.check();
+    skip_whitespace(str, pos);
+    if (pos != str.size()) throw std::runtime_error("Unexpected characters after JSON value");
+    return json;
+}
+
+const char *JSONParseError::message() const {
+    switch (code) {
+        case JSONErrorCode::NONE: return "No error";
+        case JSONErrorCode::INVALID_VALUE: return "Unqualified JSON value";
+        case JSONErrorCode::INVALID_NUMBER: return "Invalid JSON number";
+        case JSONErrorCode::NUMBER_OUT_OF_RANGE: return "JSON number out of range";
+        case JSONErrorCode::UNTERMINATED_STRING: return "Unterminated JSON string";
+        case JSONErrorCode::INVALID_ESCAPE: return "Invalid escape character";
+        case JSONErrorCode::INVALID_UNICODE_ESCAPE: return "Invalid unicode escape";
+        case JSONErrorCode::CONTROL_CHARACTER: return "Unescaped control character in JSON string";
+        case JSONErrorCode::INVALID_UTF8: return "Invalid UTF-8 in JSON string";
+        case JSONErrorCode::EXPECTED_ARRAY_SEPARATOR: return "Expected ',' or ']' in JSON array";
+        case JSONErrorCode::EXPECTED_KEY: return "Expected a key in JSON object";
+        case JSONErrorCode::EXPECTED_COLON: return "Expected ':' in JSON object";
+        case JSONErrorCode::EXPECTED_OBJECT_SEPARATOR: return "Expected ',' or '}' in JSON object";
+        case JSONErrorCode::TRAILING_CHARACTERS: return "Unexpected characters after JSON value";
+        case JSONErrorCode::TOO_DEEP: return "JSON nesting is too deep";
+    }
+    return "Unknown JSON error";
+}
+
+JSON &JSONParseResult::value() & {
+    if (!has_value()) throw std::runtime_error(parse_error.message());
+    return json;
+}
+
+const JSON &JSONParseResult::value() const & {
+    if (!has_value()) throw std::runtime_error(parse_error.message());
+    return json;
+}
+
+JSON &&JSONParseResult::value() && {
+    if (!has_value()) throw std::runtime_error(parse_error.message());
+    return std::move(json);
+}
+
+/* 校验时使用SAX解析，默认的处理函数不做任何事，不分配节点 */
+JSON JSON::parse_lazy(const LazySource &source) {
+    std::string_view str = source.text;
+    size_t pos = 0;
+    skip_whitespace(str, pos);
+    if (str.data()[pos] != '{' && str.data()[pos] != '[') throw std::runtime_error("Unqualified JSON string");
+    size_t start = pos;
+    JSONHandler validator;
+    ScanState state;
+    sax_value(str, pos, validator, state);
+    state.check();
+    skip_whitespace(str, pos);
+    if (pos != str.size()) throw std::runtime_error("Unexpected characters after JSON value");
+    JSON json;
+    json.defer(str.data()[start] == '[' ? JSON_ARRAY_TYPE : JSON_OBJECT_TYPE, &source, start);
+    json.materialize();
+    return json;
+}
+
+/* 未被选中的键和值都不会被构造：键只在buffer中还原一次用于查找，值用skip_value跳过 */
+JSON JSON::parse_projected(std::string_view str, size_t &pos, std::pmr::memory_resource *resource, ParseStack &stack,
+                           const JSONProjection &projection, size_t node) {
+    if (projection.fields[node].whole) return parse(str, pos, resource, stack);
+    skip_whitespace(str, pos);
+    JSON json = empty_container(JSON_OBJECT_TYPE);
+    if (str.data()[pos] != '{') {
+        skip_value(str, pos, stack);
+        return json;
+    }
+    ++pos;
+    skip_whitespace(str, pos);
+    if (str.data()[pos] == '}') {
+        ++pos;
+        return json;
+    }
+    size_t start = stack.members.size();
+    while (true) {
+        skip_whitespace(str, pos);
+        if (str.data()[pos] != '"') {
+            stack.fail(JSONErrorCode::EXPECTED_KEY, pos);
+            return json;
+        }
+        std::string_view key = scan_string(str, pos, stack);
+        if (stack.failed()) return json;
+        skip_whitespace(str, pos);
+        if (str.data()[pos] != ':') {
+            stack.fail(JSONErrorCode::EXPECTED_COLON, pos);
+            return json;
+        }
+        ++pos;
+        skip_whitespace(str, pos);
+        size_t child = projection.find(node, key);
+        if (child == JSONProjection::NOT_FOUND || (!projection.fields[child].whole && str.data()[pos] != '{')) {
+            if (!skip_value(str, pos, stack)) return json;
+        } else {
+            JSON key_json;
+            stack.store_key(key_json, key, resource);   // 解析值时buffer会被覆盖，先保存键
+            JSON value = parse_projected(str, pos, resource, stack, projection, child);
+            if (stack.failed()) return json;
+            stack.members.push_back({std::move(key_json), std::move(value)});
+        }
+        skip_whitespace(str, pos);
+        if (str.data()[pos] == ',') {
+            ++pos;
+        } else if (str.data()[pos] == '}') {
+            ++pos;
+            break;
+        } else {
+            stack.fail(JSONErrorCode::EXPECTED_OBJECT_SEPARATOR, pos);
+            return json;
+        }
+    }
+    if (stack.members.size() == start) return json;
+    json.object_data = new_block<JSONObject>(resource);
+    json.object_data->members.assign(std::make_move_iterator(stack.members.begin() + start),
+                                     std::make_move_iterator(stack.members.end()));
+    json.object_data->rebuild_index();
+    stack.members.resize(start);
+    return json;
+}
+
+JSON JSON::parse_projected(const string &str, const JSONProjection &projection) {
+    size_t pos = 0;
+    skip_whitespace(str, pos);
+    if (str.data()[pos] != '{' && str.data()[pos] != '[') throw std::runtime_error("Unqualified JSON string");
+    ParseStack stack;
+    JSON json = parse_projected(str, pos, std::pmr::get_default_resource(), stack, projection, 0);
+    stack.check();
+    skip_whitespace(str, pos);
+    if (pos != str.size()) throw std::runtime_error("Unexpected characters after JSON value");
+    return json;
+}
+
+/* 小于该大小的文档直接单线程解析，启动线程的开销比解析本身还大 */
+static constexpr size_t PARALLEL_PARSE_THRESHOLD = 1 << 20;
+
+/* 先做一遍结构预扫描，把顶层数组的元素按字节数均匀分成若干段，由多个线程各自解析。数组的存储一次分配好，
+ * 每段的结果直接写入自己的位置，不需要再拼接 */
+JSON JSON::parse_parallel(const string &str, unsigned threads) {
+    if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t pos = 0;
+    skip_whitespace(str, pos);
+    if (threads == 1 || str.size() < PARALLEL_PARSE_THRESHOLD || str.data()[pos] != '[') return JSON(str);
+    std::string_view text = str;
+    vector<ArrayPartition> parts = partition_array(text, pos, std::max<size_t>(str.size() / (threads * 8), 1 << 16));
+    skip_whitespace(text, pos);
+    if (pos != str.size()) throw std::runtime_error("Unexpected characters after JSON value");
+    JSON json = empty_container(JSON_ARRAY_TYPE);
+    if (parts.empty()) return json;
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource();
+    json.array_data = new_block<JSONArray>(resource);
+    auto &values = json.array_data->values;
+    values.resize(parts.back().first + parts.back().count);
+
+    std::atomic<size_t> next{0};
+    vector<std::exception_ptr> errors(parts.size());
+    auto work = [&]() {
+        // 各段的元素都在顶层数组之内，从第1层开始计数，嵌套的上限与单线程解析相同
+        ParseStack stack;
+        stack.depth = 1;
+        for (size_t i = next++; i < parts.size(); i = next++) {
+            try {
+                size_t p = parts[i].offset;
+                for (size_t k = 0; k < parts[i].count; ++k) {
+                    values[parts[i].first + k] = parse(text, p, resource, stack);
+                    stack.check();
+                    skip_whitespace(text, p);
+                    if (text.data()[p] != ',' && text.data()[p] != ']')
+                        throw std::runtime_error("Expected ',' or ']' in JSON array");
+                    ++p;
+                }
+            } catch (...) {
+                errors[i] = std::current_exception();
+                stack.reset();
+                stack.depth = 1;
+            }
+        }
+    };
+    vector<std::thread> workers;
+    for (size_t i = 1; i < std::min<size_t>(threads, parts.size()); ++i) workers.emplace_back(work);
+    work();     // 调用者的线程也参与解析
+    for (auto &worker: workers) worker.join();
+    for (const auto &error: errors) {
+        if (error) std::rethrow_exception(error);
+    }
+    return json;
+}
+
+JSON JSON::parse_file(const string &path) {
+    JSONMappedFile file(path);
+    return parse_text(file.text(), std::pmr::get_default_resource(), false);
+}
+
+/* 映射的长度向上取整到页的整数倍并且至少多出一个字节。先占用一段全零的匿名映射，再把文件映射到它的开头，
+ * 文件之后的字节因此总是'\0'，文件长度恰好是页的整数倍时也不例外 */
+JSONMappedFile::JSONMappedFile(const string &path) {
+#ifdef CPPJSON_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Could not open the file " + path);
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t length = static_cast<size_t>(st.st_size);
+        size_t region = (length / page + 1) * page;
+        void *base = mmap(nullptr, region, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base != MAP_FAILED && length > 0 &&
+            mmap(base, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            munmap(base, region);
+            base = MAP_FAILED;
+        }
+        if (base != MAP_FAILED) {
+            madvise(base, region, MADV_SEQUENTIAL);     // 解析器从头到尾顺序读取
+            data = static_cast<const char *>(base);
+            size = length;
+            mapped_size = region;
+        }
+    }
+    close(fd);
+    if (mapped_size) return;
+#endif
+    // 无法映射（如管道或不支持mmap的平台）时读入内存
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) throw std::runtime_error("Could not open the file " + path);
+    std::ostringstream content;
+    content << in.rdbuf();
+    buffer = content.str();
+    data = buffer.data();
+    size = buffer.size();
+}
+
+JSONMappedFile::~JSONMappedFile() {
+#ifdef CPPJSON_MMAP
+    if (mapped_size) munmap(const_cast<char *>(data), mapped_size);
+#endif
+}
+
+/* 内存池的初始大小按输入长度预估，大多数文档只需要一次上游分配 */
+JSONDocument::JSONDocument(const string &str) : arena(str.size() + 4096), root_value(str, &arena) {}
+
+/* 借用字符串之后，内存池中只剩节点和含转义字符的字符串，初始大小按文本长度的一半预估；
+ * 延迟解析时一开始只解析顶层，内存池从小开始 */
+JSONDocument::JSONDocument(std::unique_ptr<JSONMappedFile> mapped, string str, bool lazy)
+        : file(std::move(mapped)), text(std::move(str)),
+          arena(lazy ? 4096 : (file ? file->text().size() : text.size()) / 2 + 4096),
+          source{file ? file->text() : std::string_view(text), &arena},
+          root_value(lazy ? JSON::parse_lazy(source) : JSON::parse_text(source.text, &arena, true)) {}
+
+JSONDocument JSONDocument::parse_file(const string &path, bool lazy) {
+    return JSONDocument(std::make_unique<JSONMappedFile>(path), string(), lazy);
+}
+
+JSONDocument JSONDocument::parse_lazy(string str) {
+    return JSONDocument(nullptr, std::move(str), true);
+}
+
+/* 起始字的内容：低32位是结束字的位置，其上的24位是元素个数，个数超出时为最大值，由size()数出实际的个数 */
+static constexpr uint64_t TAPE_MAX_COUNT = (1 << 24) - 1;
+
+/* 按先序写出磁带，解析文本（作为sax_value的handler）和转换JSON共用 */
+struct JSONTape::Builder {
+    JSONTape &tape;
+    vector<std::pair<size_t, size_t>> open;    // 尚未结束的容器：起始字的位置和已有的元素个数
+
+    void word(char tag, uint64_t payload) {
+        tape.words.push_back(static_cast<uint64_t>(static_cast<unsigned char>(tag)) << 56 | payload);
+    }
+
+    void value() {
+        if (!open.empty()) ++open.back().second;
+    }
+
+    bool start(char tag) {
+        value();
+        open.emplace_back(tape.words.size(), 0);
+        word(tag, 0);
+        return true;
+    }
+
+    bool end(char tag) {
+        auto [start, count] = open.back();
+        open.pop_back();
+        size_t end = tape.words.size();
+        if (end > UINT32_MAX) throw std::runtime_error("Document too large for JSONTape");
+        tape.words[start] |= std::min<uint64_t>(count, TAPE_MAX_COUNT) << 32 | end;
+        word(tag, start);
+        return true;
+    }
+
+    void text(std::string_view value) {
+        if (value.size() > UINT32_MAX) throw std::runtime_error("String too large for JSONTape");
+        auto size = static_cast<uint32_t>(value.size());
+        word('"', tape.strings.size());
+        tape.strings.append(reinterpret_cast<const char *>(&size), sizeof size);
+        tape.strings.append(value);
+    }
+
+    void number(char tag, uint64_t bits) {
+        value();
+        word(tag, 0);
+        tape.words.push_back(bits);
+    }
+
+    bool start_object() { return start('{'); }
+
+    bool key(std::string_view key) {
+        text(key);
+        return true;
+    }
+
+    bool end_object() { return end('}'); }
+
+    bool start_array() { return start('['); }
+
+    bool end_array() { return end(']'); }
+
+    bool string_value(std::string_view value) {
+        this->value();
+        text(value);
+        return true;
+    }
+
+    bool int64_value(long long value) {
+        number('l', static_cast<uint64_t>(value));
+        return true;
+    }
+
+    bool uint64_value(unsigned long long value) {
+        number('u', value);
+        return true;
+    }
+
+    bool double_value(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof bits);
+        number('d', bits);
+        return true;
+    }
+
+    bool bool_value(bool value) {
+        this->value();
+        word(value ? 't' : 'f', 0);
+        return true;
+    }
+
+    bool null_value() {
+        value();
+        word('n', 0);
+        return true;
+    }
+
+    void add(const JSON &json) {
+        json.materialize();
+        switch (json.type) {
+            case STRING_TYPE:
+                string_value(json.string_value());
+                break;
+            case INT_TYPE:
+                if (json.is_unsigned()) uint64_value(static_cast<unsigned long long>(json.integer_value()));
+                else int64_value(json.integer_value());
+                break;
+            case FLOAT_TYPE:
+                double_value(json.floating_value());
+                break;
+            case BOOL_TYPE:
+                bool_value(json.bool_value);
+                break;
+            case NULL_TYPE:
+                null_value();
+                break;
+            case JSON_ARRAY_TYPE:
+                start_array();
+                if (json.array_data)
+                    for (const auto &value: json.array_data->values) add(value);
+                end_array();
+                break;
+            case JSON_OBJECT_TYPE:
+                start_object();
+                if (json.object_data)
+                    for (const auto &member: json.object_data->members) {
+                        key(member.key.string_value());
+                        add(member.value);
+                    }
+                end_object();
+                break;
+        }
+    }
+};
+
+/* 磁带和字符串缓冲区按文本长度宽松地预留，常见的文档不需要再扩容。大块的内存只有写到的页才真正占用，
+ * 预留多出的部分几乎没有代价 */
+/* 按结构字符估计纸带的字数：每个值最多两个字（数字的标记和值，容器的开始和结束），值的个数不超过','与'['、'{'的
+ * 个数之和加一，每个键一个字，键的个数等于':'的个数。字符串中的这些字符只会让估计偏大，不需要区分 */
+static size_t estimate_tape_words(std::string_view str) {
+    static const auto weights = []() {
+        std::array<unsigned char, 256> table{};
+        table[','] = table['['] = table['{'] = 2;
+        table[':'] = 1;
+        return table;
+    }();
+    size_t words = 2;
+    for (char c: str) words += weights[static_cast<unsigned char>(c)];
+    return words;
+}
+
+JSONTape::JSONTape(const string &str) {
+    size_t pos = 0;
+    skip_whitespace(str, pos);
+    if (str.data()[pos] != '{' && str.data()[pos] != '[') throw std::runtime_error("Unqualified JSON string");
+    words.reserve(estimate_tape_words(str));
+    strings.reserve(str.size());
+    Builder builder{*this, {}};
+    ScanState state;
+    if (!sax_value(str, pos, builder, state)) state.check();
+    skip_whitespace(str, pos);
+    if (pos != str.size()) throw std::runtime_error("Unexpected characters after JSON value");
+}
+
+JSONTape::JSONTape(const JSON &json) {
+    Builder builder{*this, {}};
+    builder.add(json);
+}
+
+JSONTape::Cursor JSONTape::root() const {
+    return Cursor(this, 0);
+}
+
+JSON JSONTape::to_json() const {
+    size_t index = 0;
+    JSON::KeyDictionary keys;
+    return build_json(index, keys);
+}
+
+/* 元素个数已知，数组和对象的存储一次分配 */
+JSON JSONTape::build_json(size_t &index, JSON::KeyDictionary &keys) const {
+    Cursor cursor(this, index);
+    JSON json;
+    switch (cursor.tag()) {
+        case '"':
+            json.set_string(static_cast<std::string_view>(cursor), std::pmr::get_default_resource());
+            break;
+        case 'l':
+            json = static_cast<long long>(cursor);
+            break;
+        case 'u':
+            json = static_cast<unsigned long long>(cursor);
+            break;
+        case 'd':
+            json = static_cast<double>(cursor);
+            break;
+        case 't':
+        case 'f':
+            json = cursor.tag() == 't';
+            break;
+        case '[': {
+            json = JSON::empty_container(JSON_ARRAY_TYPE);
+            size_t size = cursor.size();
+            ++index;
+            if (size == 0) break;
+            json.array_data = new_block<JSONArray>(std::pmr::get_default_resource());
+            json.array_data->values.reserve(size);
+            while (words[index] >> 56 != ']') json.array_data->values.push_back(build_json(index, keys));
+            break;
+        }
+        case '{': {
+            json = JSON::empty_container(JSON_OBJECT_TYPE);
+            size_t size = cursor.size();
+            ++index;
+            if (size == 0) break;
+            json.object_data = new_block<JSONObject>(std::pmr::get_default_resource());
+            auto &members = json.object_data->members;
+            members.reserve(size);
+            while (words[index] >> 56 != '}') {
+                JSON key;
+                keys.store(key, static_cast<std::string_view>(Cursor(this, index)), std::pmr::get_default_resource());
+                index = Cursor(this, index).next().index;
+                members.push_back({std::move(key), build_json(index, keys)});
+            }
+            json.object_data->rebuild_index();
+            break;
+        }
+    }
+    index = cursor.next().index;
+    return json;
+}
+
+[[noreturn]] static void tape_conversion_error(const char *type_name) {
+    throw std::runtime_error(string("Cannot convert to ") + type_name + " type");
+}
+
+size_t JSONTape::Cursor::size() const {
+    if (tag() != '[' && tag() != '{') throw std::runtime_error("The value is not an array or object");
+    size_t count = payload() >> 32;
+    if (count < TAPE_MAX_COUNT) return count;
+    count = 0;
+    for (Cursor it = child(); !it.at_end(); it = tag() == '{' ? it.next().next() : it.next()) ++count;
+    return count;
+}
+
+JSONTape::Cursor JSONTape::Cursor::child() const {
+    if (tag() != '[' && tag() != '{') throw std::runtime_error("The value is not an array or object");
+    return Cursor(tape, index + 1);
+}
+
+JSONTape::Cursor JSONTape::Cursor::next() const {
+    switch (tag()) {
+        case '[':
+        case '{':
+            return Cursor(tape, (payload() & UINT32_MAX) + 1);
+        case 'l':
+        case 'u':
+        case 'd':
+            return Cursor(tape, index + 2);
+        default:
+            return Cursor(tape, index + 1);
+    }
+}
+
+JSONTape::Cursor JSONTape::Cursor::operator[](size_t i) const {
+    if (tag() != '[') throw std::runtime_error("The value is not an array");
+    if (i >= size()) throw std::out_of_range("Index out of range");
+    Cursor it = child();
+    while (i--) it = it.next();
+    return it;
+}
+
+JSONTape::Cursor JSONTape::Cursor::at(std::string_view key) const {
+    if (auto value = find(key)) return *value;
+    throw std::out_of_range("The key does not exist");
+}
+
+std::optional<JSONTape::Cursor> JSONTape::Cursor::find(std::string_view key) const {
+    if (tag() != '{') throw std::runtime_error("The value is not an object");
+    for (Cursor it = child(); !it.at_end(); it = it.next().next())
+        if (static_cast<std::string_view>(it) == key) return it.next();
+    return std::nullopt;
+}
+
+JSONTape::Cursor::operator long long() const {
+    if (tag() != 'l') tape_conversion_error("long long");
+    return static_cast<long long>(tape->words[index + 1]);
+}
+
+JSONTape::Cursor::operator unsigned long long() const {
+    if (tag() != 'u' && (tag() != 'l' || static_cast<long long>(tape->words[index + 1]) < 0))
+        tape_conversion_error("unsigned long long");
+    return tape->words[index + 1];
+}
+
+JSONTape::Cursor::operator double() const {
+    if (tag() != 'd') tape_conversion_error("double");
+    double value;
+    std::memcpy(&value, &tape->words[index + 1], sizeof value);
+    return value;
+}
+
+JSONTape::Cursor::operator bool() const {
+    if (tag() != 't' && tag() != 'f') tape_conversion_error("bool");
+    return tag() == 't';
+}
+
+JSONTape::Cursor::operator std::string_view() const {
+    if (tag() != '"') tape_conversion_error("string");
+    const char *data = tape->strings.data() + payload();
+    uint32_t size;
+    std::memcpy(&size, data, sizeof size);
+    return {data + sizeof size, size};
+}
+
+JSON JSONTape::Cursor::to_json() const {
+    size_t i = index;
+    JSON::KeyDictionary keys;
+    return tape->build_json(i, keys);
+}
+
+/* 解析状态只在读取器内部使用，放在实现文件中 */
+struct JSONReader::State : ScanState {};
+
+/* 只校验而不产生任何值的handler，用于跳过未登记的键对应的值 */
+struct SkipHandler {
+    bool start_object() { return true; }
+
+    bool key(std::string_view) { return true; }
+
+    bool end_object() { return true; }
+
+    bool start_array() { return true; }
+
+    bool end_array() { return true; }
+
+    bool string_value(std::string_view) { return true; }
+
+    bool int64_value(long long) { return true; }
+
+    bool uint64_value(unsigned long long) { return true; }
+
+    bool double_value(double) { return true; }
+
+    bool bool_value(bool) { return true; }
+
+    bool null_value() { return true; }
+};
+
+JSONReader::JSONReader(const string &text) : text(text), state(std::make_unique<State>()) {}
+
+JSONReader::~JSONReader() = default;
+
+void JSONReader::start_object() {
+    skip_whitespace(text, pos);
+    if (text.data()[pos] != '{') JSON::conversion_error("object");
+    ++pos;
+    after_open = true;
+}
+
+bool JSONReader::next_key(std::string_view &key) {
+    skip_whitespace(text, pos);
+    if (text.data()[pos] == '}') {
+        ++pos;
+        after_open = false;
+        return false;
+    }
+    if (!after_open) {
+        if (text.data()[pos] != ',') state->fail(JSONErrorCode::EXPECTED_OBJECT_SEPARATOR, pos);
+        skip_whitespace(text, ++pos);
+    }
+    after_open = false;
+    if (text.data()[pos] != '"') state->fail(JSONErrorCode::EXPECTED_KEY, pos);
+    if (!state->failed()) key = scan_string(text, pos, *state);
+    skip_whitespace(text, pos);
+    if (!state->failed() && text.data()[pos] != ':') state->fail(JSONErrorCode::EXPECTED_COLON, pos);
+    state->check();
+    ++pos;
+    return true;
+}
+
+void JSONReader::start_array() {
+    skip_whitespace(text, pos);
+    if (text.data()[pos] != '[') JSON::conversion_error("array");
+    ++pos;
+    after_open = true;
+}
+
+bool JSONReader::next_element() {
+    skip_whitespace(text, pos);
+    if (text.data()[pos] == ']') {
+        ++pos;
+        after_open = false;
+        return false;
+    }
+    if (!after_open) {
+        if (text.data()[pos] != ',') state->fail(JSONErrorCode::EXPECTED_ARRAY_SEPARATOR, pos);
+        state->check();
+        ++pos;
+    }
+    after_open = false;
+    return true;
+}
+
+bool JSONReader::read_null() {
+    skip_whitespace(text, pos);
+    if (!match_literal(text, pos, "null", 4)) return false;
+    pos += 4;
+    return true;
+}
+
+bool JSONReader::read_bool() {
+    skip_whitespace(text, pos);
+    if (match_literal(text, pos, "true", 4)) {
+        pos += 4;
+        return true;
+    }
+    if (!match_literal(text, pos, "false", 5)) JSON::conversion_error("bool");
+    pos += 5;
+    return false;
+}
+
+long long JSONReader::read_int() {
+    skip_whitespace(text, pos);
+    char c = text.data()[pos];
+    if (!is_digit(c) && c != '-' && c != '+') JSON::conversion_error("long long");
+    long long int_value;
+    double float_value;
+    NumberKind kind = scan_number(text, pos, int_value, float_value, *state);
+    state->check();
+    if (kind != NumberKind::SIGNED) JSON::conversion_error("long long");
+    return int_value;
+}
+
+unsigned long long JSONReader::read_uint() {
+    skip_whitespace(text, pos);
+    char c = text.data()[pos];
+    if (!is_digit(c) && c != '+') JSON::conversion_error("unsigned long long");
+    long long int_value;
+    double float_value;
+    NumberKind kind = scan_number(text, pos, int_value, float_value, *state);
+    state->check();
+    if (kind == NumberKind::FLOAT) JSON::conversion_error("unsigned long long");
+    return static_cast<unsigned long long>(int_value);
+}
+
+double JSONReader::read_double() {
+    skip_whitespace(text, pos);
+    char c = text.data()[pos];
+    if (!is_digit(c) && c != '-' && c != '+') JSON::conversion_error("double");
+    long long int_value;
+    double float_value;
+    NumberKind kind = scan_number(text, pos, int_value, float_value, *state);
+    state->check();
+    if (kind == NumberKind::UNSIGNED) return static_cast<double>(static_cast<unsigned long long>(int_value));
+    return kind == NumberKind::FLOAT ? float_value : static_cast<double>(int_value);
+}
+
+std::string_view JSONReader::read_string() {
+    skip_whitespace(text, pos);
+    if (text.data()[pos] != '"') JSON::conversion_error("string");
+    std::string_view value = scan_string(text, pos, *state);
+    state->check();
+    return value;
+}
+
+JSON JSONReader::read_json() {
+    JSON::ParseStack stack;
+    JSON json = JSON::parse(text, pos, std::pmr::get_default_resource(), stack);
+    stack.check();
+    return json;
+}
+
+void JSONReader::skip_value() {
+    SkipHandler handler;
+    if (!sax_value(text, pos, handler, *state)) state->check();
+}
+
+void JSONReader::finish() {
+    skip_whitespace(text, pos);
+    if (pos != text.size()) throw std::runtime_error("Unexpected characters after JSON value");
+}
+
+/* parse_ndjson的实现：输入先按行切分成约BATCH_BYTES字节的批，工作线程依次领取批号并解析，结果按批号放入
+ * 环形的窗口中，调用者的线程按顺序取出并交给callback，之后把记录放回窗口，由下一个使用该位置的工作线程析构。
+ * 工作线程最多领先调用者一个窗口，因此同时存在的记录数有上限，与输入的大小无关 */
+class NDJSONReader {
+public:
+    // projection不为空时每条记录按它解析
+    NDJSONReader(std::string_view text, unsigned threads, const JSONProjection *projection = nullptr);
+
+    size_t run(const std::function<void(vector<JSON> &)> &callback);
+
+private:
+    struct Batch {
+        vector<JSON> values;
+        std::exception_ptr error;   // 解析本批时抛出的异常，轮到本批时在调用者的线程中重新抛出
+        bool ready = false;
+    };
+
+    static constexpr size_t BATCH_BYTES = 1 << 20;
+
+    void work();
+
+    void parse_batch(size_t begin, size_t end, vector<JSON> &values, JSON::ParseStack &stack) const;
+
+    string position(size_t line_start) const;
+
+    std::string_view text;      // 末尾之后的一个字节为'\0'
+    unsigned threads;
+    const JSONProjection *projection;
+    vector<size_t> bounds;      // 第i批为[bounds[i], bounds[i + 1])，每批都在换行符之后结束
+    size_t count;               // 批数
+    vector<Batch> window;       // 第i批放在window[i % window.size()]中
+    std::mutex mutex;           // 保护以下成员和window
+    std::condition_variable changed;
+    size_t next = 0;            // 下一个待领取的批号
+    size_t delivered = 0;       // 已经交给callback的批数
+    bool stopped = false;
+};
+
+NDJSONReader::NDJSONReader(std::string_view text, unsigned threads, const JSONProjection *projection)
+        : text(text), threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+          projection(projection) {
+    bounds.push_back(0);
+    while (bounds.back() < text.size()) {
+        size_t pos = bounds.back() + BATCH_BYTES;
+        if (pos >= text.size()) {
+            pos = text.size();
+        } else {
+            auto newline = static_cast<const char *>(std::memchr(text.data() + pos, '\n', text.size() - pos));
+            pos = newline ? newline - text.data() + 1 : text.size();
+        }
+        bounds.push_back(pos);
+    }
+    count = bounds.size() - 1;
+    window.resize(std::max<size_t>(1, std::min<size_t>(count, this->threads * 4)));
+}
+
+/* 出错时报告的位置：从1开始的行号和该行开头的字节偏移。只在出错时数一遍之前的换行符 */
+string NDJSONReader::position(size_t line_start) const {
+    size_t line = 1 + std::count(text.data(), text.data() + line_start, '\n');
+    return "line " + std::to_string(line) + " (byte " + std::to_string(line_start) + ")";
+}
+
+/* 每行的值从整个输入上解析，因此解析器仍然可以依赖末尾的'\0'；值的结尾越过本行时按不合法处理 */
+void NDJSONReader::parse_batch(size_t begin, size_t end, vector<JSON> &values, JSON::ParseStack &stack) const {
+    const char *data = text.data();
+    stack.reset();
+    for (size_t pos = begin; pos < end;) {
+        auto newline = static_cast<const char *>(std::memchr(data + pos, '\n', end - pos));
+        size_t line_end = newline ? newline - data : end;
+        size_t p = pos;
+        while (p < line_end && is_whitespace(data[p])) ++p;
+        if (p < line_end) {
+            auto resource = std::pmr::get_default_resource();
+            values.push_back(projection ? JSON::parse_projected(text, p, resource, stack, *projection, 0)
+                                        : JSON::parse(text, p, resource, stack));
+            if (stack.failed())
+                throw std::runtime_error("Invalid JSON record at " + position(pos) + ": " + stack.error.message());
+            while (p < line_end && is_whitespace(data[p])) ++p;
+            if (p != line_end) throw std::runtime_error("Unexpected characters after JSON record at " + position(pos));
+        }
+        pos = line_end + 1;
+    }
+}
+
+void NDJSONReader::work() {
+    JSON::ParseStack stack;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [this]() { return stopped || next == count || next < delivered + window.size(); });
+        if (stopped || next == count) return;
+        size_t i = next++;
+        // 窗口中留着调用者用完的上一批记录，在这里析构，调用者的线程只负责交付
+        vector<JSON> used = std::move(window[i % window.size()].values);
+        lock.unlock();
+        used.clear();
+        Batch batch;
+        try {
+            parse_batch(bounds[i], bounds[i + 1], batch.values, stack);
+        } catch (...) {
+            batch.error = std::current_exception();
+        }
+        batch.ready = true;
+        lock.lock();
+        window[i % window.size()] = std::move(batch);
+        changed.notify_all();
+    }
+}
+
+size_t NDJSONReader::run(const std::function<void(vector<JSON> &)> &callback) {
+    vector<std::thread> workers;
+    // 无论正常结束还是抛出异常，都先让工作线程退出再返回
+    struct Stop {
+        NDJSONReader &reader;
+        vector<std::thread> &workers;
+
+        ~Stop() {
+            {
+                std::lock_guard<std::mutex> lock(reader.mutex);
+                reader.stopped = true;
+            }
+            reader.changed.notify_all();
+            for (auto &worker: workers) worker.join();
+        }
+    } stop{*this, workers};
+    for (size_t i = 0; i < std::min<size_t>(threads, count); ++i) workers.emplace_back(&NDJSONReader::work, this);
+    size_t records = 0;
+    for (size_t i = 0; i < count; ++i) {
+        Batch batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            Batch &slot = window[i % window.size()];
+            changed.wait(lock, [&slot]() { return slot.ready; });
+            batch = std::move(slot);
+            slot.ready = false;
+        }
+        if (batch.error) std::rethrow_exception(batch.error);
+        records += batch.values.size();
+        callback(batch.values);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            window[i % window.size()].values = std::move(batch.values);
+            ++delivered;
+        }
+        changed.notify_all();
+    }
+    return records;
+}
+
+size_t parse_ndjson(const string &text, const std::function<void(vector<JSON> &)> &callback, unsigned threads) {
+    return NDJSONReader(text, threads).run(callback);
+}
+
+size_t parse_ndjson_file(const string &path, const std::function<void(vector<JSON> &)> &callback, unsigned threads) {
+    JSONMappedFile file(path);
+    return NDJSONReader(file.text(), threads).run(callback);
+}
+
+size_t parse_ndjson(const string &text, const JSONProjection &projection,
+                    const std::function<void(vector<JSON> &)> &callback, unsigned threads) {
+    return NDJSONReader(text, threads, &projection).run(callback);
+}
+
+size_t parse_ndjson_file(const string &path, const JSONProjection &projection,
+                         const std::function<void(vector<JSON> &)> &callback, unsigned threads) {
+    JSONMappedFile file(path);
+    return NDJSONReader(file.text(), threads, &projection).run(callback);
+}
+
+/* 查找键的下标，有重复的键时返回第一个。键少时线性查找，否则使用哈希索引 */
+size_t JSONObject::find_key(std::string_view key) const {
+    return find_key(key, key_index.empty() ? 0 : std::hash<std::string_view>()(key));
+}
+
+size_t JSONObject::find_key(std::string_view key, size_t hash) const {
+    if (key_index.empty()) {
+        size_t i = 0;
+        while (i < members.size() && members[i].key.string_value() != key) ++i;
+        return i;
+    }
+    size_t mask = key_index.size() - 1;
+    size_t slot = hash & mask;
+    while (key_index[slot] != 0) {
+        if (members[key_index[slot] - 1].key.string_value() == key) return key_index[slot] - 1;
+        slot = (slot + 1) & mask;
+    }
+    return members.size();
+}
+
+/* 将第i个键插入哈希索引，已有相同的键时保留先出现的那个，与线性查找的结果一致 */
+void JSONObject::index_key(size_t i) {
+    std::string_view key = members[i].key.string_value();
+    size_t mask = key_index.size() - 1;
+    size_t slot = std::hash<std::string_view>()(key) & mask;
+    while (key_index[slot] != 0) {
+        if (members[key_index[slot] - 1].key.string_value() == key) return;
+        slot = (slot + 1) & mask;
+    }
+    key_index[slot] = static_cast<uint32_t>(i + 1);
+}
+
+/* 追加的键使索引过满或使键的个数达到INDEX_THRESHOLD时重建，否则只插入这一个键 */
+void JSONObject::index_last_key() {
+    if (key_index.empty() ? members.size() >= INDEX_THRESHOLD : 2 * members.size() > key_index.size())
+        rebuild_index();
+    else if (!key_index.empty())
+        index_key(members.size() - 1);
+}
+
+/* 重建哈希索引，表的大小为2的幂且不小于键个数的2倍 */
+void JSONObject::rebuild_index() {
+    if (members.size() < INDEX_THRESHOLD) {
+        key_index.clear();
+        return;
+    }
+    size_t capacity = 2 * INDEX_THRESHOLD;
+    while (capacity < 2 * members.size()) capacity <<= 1;
+    key_index.assign(capacity, 0);
+    for (size_t i = 0; i < members.size(); ++i) index_key(i);
+}
+
+JSON JSON::empty_container(unsigned char container_type) {
+    JSON json;
+    json.type = container_type;
+    if (container_type == JSON_ARRAY_TYPE)
+        json.array_data = nullptr;
+    else
+        json.object_data = nullptr;
+    return json;
+}
+
+/* 短字符串从short_string开始保存，跨过short_string一直延续到short_tail的末尾 */
+std::string_view JSON::string_value() const {
+    if (short_size == LONG_STRING) return {long_string->data(), long_string->size};
+    if (short_size == SHARED_STRING) return {shared_string->data(), shared_string->size};
+    if (short_size == BORROWED_STRING) {
+        uint32_t size;
+        std::memcpy(&size, short_string + 2, sizeof size);
+        return {borrowed_string, size};
+    }
+    return {reinterpret_cast<const char *>(this) + offsetof(JSON, short_string), short_size};
+}
+
+void JSON::set_string(std::string_view value, std::pmr::memory_resource *resource) {
+    release();
+    char *data;
+    if (value.size() <= SHORT_STRING_CAPACITY) {
+        short_size = static_cast<unsigned char>(value.size());
+        data = reinterpret_cast<char *>(this) + offsetof(JSON, short_string);
+    } else {
+        void *p = resource->allocate(sizeof(StringData) + value.size(), alignof(StringData));
+        long_string = new(p) StringData{resource, value.size()};
+        short_size = LONG_STRING;
+        data = reinterpret_cast<char *>(long_string + 1);
+    }
+    std::copy(value.begin(), value.end(), data);
+    type = STRING_TYPE;
+}
+
+/* 探测序列与JSONObject的哈希索引相同。表的负载不超过一半 */
+void JSON::KeyDictionary::store(JSON &json, std::string_view key, std::pmr::memory_resource *resource) {
+    json.release();
+    if (key.size() <= SHORT_STRING_CAPACITY) {
+        json.set_string(key, resource);
+        return;
+    }
+    size_t mask = slots.size() - 1, slot = 0;
+    if (!slots.empty()) {
+        slot = std::hash<std::string_view>()(key) & mask;
+        for (; slots[slot]; slot = (slot + 1) & mask) {
+            SharedString *shared = slots[slot];
+            if (shared->size == key.size() && std::memcmp(shared->data(), key.data(), key.size()) == 0) {
+                if (shared->resource != resource) break;
+                ++shared->refs;
+                json.shared_string = shared;
+                json.short_size = SHARED_STRING;
+                json.type = STRING_TYPE;
+                return;
+            }
+        }
+    }
+    void *p = resource->allocate(sizeof(SharedString) + key.size(), alignof(SharedString));
+    SharedString *shared = new(p) SharedString{{1}, resource, key.size()};
+    std::copy(key.begin(), key.end(), reinterpret_cast<char *>(shared + 1));
+    json.shared_string = shared;
+    json.short_size = SHARED_STRING;
+    json.type = STRING_TYPE;
+    if (count == MAX_KEYS || (!slots.empty() && slots[slot])) return;    // 表已满，或同名的键来自其他内存资源
+    if (2 * (count + 1) > slots.size()) {
+        vector<SharedString *> old(std::max<size_t>(64, slots.size() * 2), nullptr);
+        old.swap(slots);
+        mask = slots.size() - 1;
+        for (SharedString *entry: old) {
+            if (!entry) continue;
+            size_t i = std::hash<std::string_view>()({entry->data(), entry->size}) & mask;
+            while (slots[i]) i = (i + 1) & mask;
+            slots[i] = entry;
+        }
+        slot = std::hash<std::string_view>()(key) & mask;
+        while (slots[slot]) slot = (slot + 1) & mask;
+    }
+    ++shared->refs;
+    slots[slot] = shared;
+    ++count;
+}
+
+void JSON::KeyDictionary::clear() noexcept {
+    for (SharedString *&shared: slots) {
+        if (shared && --shared->refs == 0)
+            shared->resource->deallocate(shared, sizeof(SharedString) + shared->size, alignof(SharedString));
+        shared = nullptr;
+    }
+    count = 0;
+}
+
+/* 值仍留在节点的类型中，number_data保存值的副本和原文 */
+void JSON::keep_number_text(std::string_view text, std::pmr::memory_resource *resource) {
+    void *p = resource->allocate(sizeof(NumberData) + text.size(), alignof(NumberData));
+    NumberData *data = new(p) NumberData{resource, text.size(), 0, 0.0, is_unsigned()};
+    if (type == INT_TYPE)
+        data->int_value = int_value;
+    else
+        data->float_value = float_value;
+    std::copy(text.begin(), text.end(), reinterpret_cast<char *>(data + 1));
+    number_data = data;
+    short_size = NUMBER_TEXT;
+}
+
+std::string_view JSON::number_text() const {
+    if (short_size != NUMBER_TEXT) return {};
+    return {number_data->data(), number_data->size};
+}
+
+void JSON::borrow_string(std::string_view value) {
+    auto size = static_cast<uint32_t>(value.size());
+    std::memcpy(short_string + 2, &size, sizeof size);
+    short_size = BORROWED_STRING;
+    borrowed_string = value.data();
+    type = STRING_TYPE;
+}
+
+/* 位置按小端顺序保存在short_string的6个字节中 */
+void JSON::defer(unsigned char container_type, const LazySource *source, size_t offset) {
+    for (size_t i = 0; i < sizeof short_string; ++i) short_string[i] = static_cast<char>(offset >> (8 * i));
+    short_size = LAZY_CONTAINER;
+    lazy_source = source;
+    type = container_type;
+}
+
+/* 只解析本层，其中嵌套的数组和对象仍然延迟解析。文本在整个文档解析时已经校验过。
+ * 逐个访问小容器时每次都新建临时栈的开销比解析本身还大，因此每个线程复用同一个栈 */
+void JSON::parse_deferred() const {
+    size_t offset = 0;
+    for (size_t i = 0; i < sizeof short_string; ++i)
+        offset |= static_cast<size_t>(static_cast<unsigned char>(short_string[i])) << (8 * i);
+    const LazySource *source = lazy_source;
+    static thread_local ParseStack stack;
+    stack.reset();
+    stack.borrow_strings = true;
+    stack.lazy_source = source;
+    JSON json = parse(source->text, offset, source->resource, stack);
+    stack.check();
+    JSON &self = const_cast<JSON &>(*this);
+    self.short_size = 0;
+    self.steal(json);
+}
+
+void JSON::materialize_tree() const {
+    materialize();
+    if (type == JSON_ARRAY_TYPE && array_data) {
+        for (const JSON &value: array_data->values) value.materialize_tree();
+    } else if (type == JSON_OBJECT_TYPE && object_data) {
+        for (const auto &member: object_data->members) member.value.materialize_tree();
+    }
+}
+
+void JSON::release() noexcept {
+    if (type == STRING_TYPE && short_size == LONG_STRING) {
+        long_string->resource->deallocate(long_string, sizeof(StringData) + long_string->size, alignof(StringData));
+    } else if (type == STRING_TYPE && short_size == SHARED_STRING) {
+        if (--shared_string->refs == 0) {
+            shared_string->resource->deallocate(shared_string, sizeof(SharedString) + shared_string->size,
+                                                alignof(SharedString));
+        }
+    } else if (short_size == NUMBER_TEXT) {
+        number_data->resource->deallocate(number_data, sizeof(NumberData) + number_data->size, alignof(NumberData));
+    } else if (short_size == LAZY_CONTAINER) {
+        // 延迟解析的容器不持有存储
+    } else if (type == JSON_ARRAY_TYPE) {
+        unref_block(array_data);
+    } else if (type == JSON_OBJECT_TYPE) {
+        unref_block(object_data);
+    }
+    type = NULL_TYPE;
+    short_size = 0;
+}
+
+/* 逐个节点深拷贝。空的数组和对象仍然不分配存储，对象的哈希索引直接复制。
+ * 共用的字符串在同一个内存资源中只增加引用计数 */
+void JSON::copy_from(const JSON &json, std::pmr::memory_resource *resource) {
+    json.materialize();
+    if (json.type == STRING_TYPE && json.short_size == SHARED_STRING && json.shared_string->resource == resource) {
+        release();
+        ++json.shared_string->refs;
+        std::memcpy(static_cast<void *>(this), static_cast<const void *>(&json), sizeof(JSON));
+    } else if (json.type == STRING_TYPE) {
+        set_string(json.string_value(), resource);
+    } else if (json.short_size == NUMBER_TEXT) {
+        release();
+        type = json.type;
+        if (type == INT_TYPE) {
+            int_value = json.integer_value();
+            if (json.is_unsigned()) short_size = UNSIGNED_INTEGER;
+        } else {
+            float_value = json.floating_value();
+        }
+        keep_number_text(json.number_text(), resource);
+    } else if (json.type == JSON_ARRAY_TYPE) {
+        *this = empty_container(JSON_ARRAY_TYPE);
+        if (json.array_data && !json.array_data->values.empty()) {
+            const auto &source = json.array_data->values;
+            array_data = new_block<JSONArray>(resource);
+            array_data->values.resize(source.size());
+            for (size_t i = 0; i < source.size(); ++i) array_data->values[i].copy_from(source[i], resource);
         }
+    } else if (json.type == JSON_OBJECT_TYPE) {
+        *this = empty_container(JSON_OBJECT_TYPE);
+        if (json.object_data && !json.object_data->members.empty()) {
+            const JSONObject &source = *json.object_data;
+            object_data = new_block<JSONObject>(resource);
+            object_data->members.resize(source.members.size());
+            for (size_t i = 0; i < source.members.size(); ++i) {
+                object_data->members[i].key.copy_from(source.members[i].key, resource);
+                object_data->members[i].value.copy_from(source.members[i].value, resource);
+            }
+            object_data->key_index.assign(source.key_index.begin(), source.key_index.end());
+        }
+    } else {
+        std::memcpy(static_cast<void *>(this), static_cast<const void *>(&json), sizeof(JSON));
     }
-    // 值为null
-    else if (str[pos] == 'n') {
-        pos += 4;
-        return make_shared<JSON>(JSON::Value(std::in_place_type<NULLValue>));
+}
+
+JSON JSON::share(std::pmr::memory_resource *resource) const {
+    JSON json;
+    if (type == JSON_ARRAY_TYPE || type == JSON_OBJECT_TYPE) {
+        std::memcpy(static_cast<void *>(&json), static_cast<const void *>(this), sizeof(JSON));
+        if (short_size == LAZY_CONTAINER) return json;    // 尚未解析的容器与本节点指向同一段文本
+        if (type == JSON_ARRAY_TYPE && array_data) ++array_data->refs;
+        if (type == JSON_OBJECT_TYPE && object_data) ++object_data->refs;
+    } else {
+        json.copy_from(*this, resource);
     }
-    // 值为json数组类型
-    else if (str[pos] == '[') {
-        size_t start = pos;
-        int braces = 1;
-        ++pos;
-        while (braces > 0) {
-            if (str[pos] == '[') ++braces;
-            if (str[pos] == ']') --braces;
-            ++pos;
-        }
-        string json_str = str.substr(start, pos - start);
-        return make_shared<JSON>(JSON::Value(std::in_place_type<JSONArray>, json_str));
+    return json;
+}
+
+/* 对象和数组只共享存储，标量直接拷贝 */
+JSON JSON::snapshot() const {
+    return share(std::pmr::get_default_resource());
+}
+
+/* 复制出的存储与原存储使用相同的内存资源，其中的子数组和子对象仍然共享 */
+JSONArray &JSON::mutable_array() {
+    materialize();
+    if (!array_data) {
+        array_data = new_block<JSONArray>(std::pmr::get_default_resource());
+    } else if (array_data->refs > 1) {
+        JSON copy = empty_container(JSON_ARRAY_TYPE);
+        copy.array_data = new_block<JSONArray>(array_data->resource);
+        copy.array_data->values.reserve(array_data->values.size());
+        for (const auto &value: array_data->values)
+            copy.array_data->values.push_back(value.share(copy.array_data->resource));
+        release();
+        steal(copy);
     }
-    // 值为json对象类型
-    else if (str[pos] == '{') {
-        size_t start = pos;
-        int braces = 1;
-        ++pos;
-        while (braces > 0) {
-            if (str[pos] == '{') ++braces;
-            if (str[pos] == '}') --braces;
-            ++pos;
-        }
-        string json_str = str.substr(start, pos - start);
-        return make_shared<JSON>(JSON::Value(std::in_place_type<JSONObject>, json_str));
+    return *array_data;
+}
+
+JSONObject &JSON::mutable_object() {
+    materialize();
+    if (!object_data) {
+        object_data = new_block<JSONObject>(std::pmr::get_default_resource());
+    } else if (object_data->refs > 1) {
+        JSON copy = empty_container(JSON_OBJECT_TYPE);
+        JSONObject &target = *(copy.object_data = new_block<JSONObject>(object_data->resource));
+        target.members.reserve(object_data->members.size());
+        for (const auto &member: object_data->members)
+            target.members.push_back({member.key.share(target.resource), member.value.share(target.resource)});
+        target.key_index.assign(object_data->key_index.begin(), object_data->key_index.end());
+        release();
+        steal(copy);
     }
-    throw std::runtime_error("Unqualified JSON value");
+    return *object_data;
 }
 
-/* 解析一个json字符串，将键值对存储在数据成员中 */
-JSONObject::JSONObject(const string &json_str) : BaseValue(JSON_OBJECT_TYPE) {
-    size_t pos = 0;
-    while (pos < json_str.size()) {
-        if (json_str[pos] == '"') {
-            size_t start = pos + 1;
-            size_t end = json_str.find('"', start);
-            string key = json_str.substr(start, end - start);
-            object_key.push_back(key);
-            pos = end + 1;
-
-            while (json_str[pos] != ':') ++pos;
-            ++pos;
+JSON::JSON(const JSON &json) : JSON() {
+    copy_from(json, std::pmr::get_default_resource());
+}
 
-            object_value.push_back(parse_value(json_str, pos));
-        }
-        ++pos;
-    }
+/* 格式化输出时换行并缩进到第depth层 */
+static void append_newline(string &out, int indent, int depth) {
+    out.push_back('\n');
+    out.append(static_cast<size_t>(indent) * depth, ' ');
 }
 
-/* 拷贝构造函数，实现值拷贝 */
-JSONObject::JSONObject(const JSONObject &cj) : BaseValue(cj.value_type) {
-    *this = cj;   // 调用拷贝赋值运算符
+template<typename T>
+static void append_int(string &out, T value) {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof buffer, value);
+    out.append(buffer, result.ptr);
 }
 
-/* 拷贝赋值运算符，实现值拷贝 */
-JSONObject &JSONObject::operator=(const JSONObject &json_object) {
-    this->object_value.clear();
-    this->object_key = json_object.object_key;
-    for (const auto &i: json_object.object_value) {
-        this->object_value.push_back(make_shared<JSON>(*i));
+/* 以能精确还原double的最短形式输出。整数值的浮点数补上".0"，重新解析后仍为浮点类型；
+ * JSON不能表示无穷大和NaN，输出为null */
+static void append_double(string &out, double value) {
+    if (!std::isfinite(value)) {
+        out += "null";
+        return;
     }
-    return *this;
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof buffer, value);
+    out.append(buffer, result.ptr);
+    if (std::find_if(buffer, result.ptr, [](char c) { return c == '.' || c == 'e'; }) == result.ptr)
+        out += ".0";
 }
 
-/* 返回JSON对象的键 */
-vector<string> JSONObject::keys() {
-    return object_key;
+void JSONWriter::string_value(string &out, std::string_view value) {
+    append_string(out, value);
 }
 
-ostream &operator<<(ostream &out, const JSONObject &json_object) {
-    out << "{";
-    size_t i = 0;
-    for (; i < json_object.object_key.size(); ++i) {
-        out << "\"" << json_object.object_key[i] << "\":";
-        std::visit([&out](const auto &v) {
-            operator<<(out, v);
-        }, (*json_object.object_value[i]).value);
-        if (i != json_object.object_key.size() - 1) {
-            out << ",";
+void JSONWriter::int_value(string &out, long long value) {
+    append_int(out, value);
+}
+
+void JSONWriter::uint_value(string &out, unsigned long long value) {
+    append_int(out, value);
+}
+
+void JSONWriter::double_value(string &out, double value) {
+    append_double(out, value);
+}
+
+/* 保留了原文的数字原样输出 */
+void JSON::append_number(string &out) const {
+    if (short_size == NUMBER_TEXT)
+        out.append(number_data->data(), number_data->size);
+    else if (type == FLOAT_TYPE)
+        append_double(out, float_value);
+    else if (short_size == UNSIGNED_INTEGER)
+        append_int(out, static_cast<unsigned long long>(int_value));
+    else
+        append_int(out, int_value);
+}
+
+void JSON::dump_value(string &out, int indent, int depth) const {
+    switch (type) {
+        case STRING_TYPE:
+            append_string(out, string_value());
+            break;
+        case INT_TYPE:
+        case FLOAT_TYPE:
+            append_number(out);
+            break;
+        case BOOL_TYPE:
+            out += bool_value ? "true" : "false";
+            break;
+        case NULL_TYPE:
+            out += "null";
+            break;
+        case JSON_ARRAY_TYPE:
+        case JSON_OBJECT_TYPE: {
+            size_t size = JSONSize(*this);
+            bool is_array = type == JSON_ARRAY_TYPE;
+            if (size == 0) {
+                out += is_array ? "[]" : "{}";
+                break;
+            }
+            out.push_back(is_array ? '[' : '{');
+            dump_members(out, indent, depth, 0, size);
+            if (indent >= 0) append_newline(out, indent, depth);
+            out.push_back(is_array ? ']' : '}');
+            break;
         }
     }
-    out << "}";
-    return out;
 }
 
-JSON &JSONObject::operator[](const string &key) {
-    auto pos = std::find(object_key.begin(), object_key.end(), key);
-    if (pos != object_key.end()) {
-        return *object_value[pos - object_key.begin()];
-    } else {
-        object_key.push_back(key);
-        object_value.push_back(make_shared<JSON>(JSON::Value(std::in_place_type<NULLValue>)));
-        return *object_value[object_value.size() - 1];
+/* 第i个元素（键值对）之前的逗号、换行缩进和键 */
+void JSON::dump_member_prefix(string &out, int indent, int depth, size_t i) const {
+    if (i) out.push_back(',');
+    if (indent >= 0) append_newline(out, indent, depth + 1);
+    if (type == JSON_OBJECT_TYPE) {
+        append_string(out, object_data->members[i].key.string_value());
+        out += indent >= 0 ? ": " : ":";
     }
 }
 
-JSON &JSONObject::at(const string &key) {
-    auto pos = std::find(object_key.begin(), object_key.end(), key);
-    if (pos != object_key.end()) {
-        return *object_value[pos - object_key.begin()];
-    } else {
-        throw std::out_of_range("The key does not exist");
+void JSON::dump_members(string &out, int indent, int depth, size_t begin, size_t end) const {
+    for (size_t i = begin; i < end; ++i) {
+        dump_member_prefix(out, indent, depth, i);
+        if (type == JSON_ARRAY_TYPE)
+            array_data->values[i].dump_value(out, indent, depth + 1);
+        else
+            object_data->members[i].value.dump_value(out, indent, depth + 1);
     }
 }
 
-JSONObject &JSONObject::merge(const JSONObject &json_object) {
-    this->object_key.insert(this->object_key.end(), json_object.object_key.begin(), json_object.object_key.end());
-    this->object_value.insert(this->object_value.end(), json_object.object_value.begin(),
-                              json_object.object_value.end());
-    return *this;
+string JSON::dump(int indent) const {
+    string out;
+    dump_value(out, indent, 0);
+    return out;
 }
 
-/* 解析一个json字符串，将值存储在数据成员中 */
-JSONArray::JSONArray(const string &json_str) : BaseValue(JSON_ARRAY_TYPE) {
-    size_t pos = 0;
-    while (json_str[pos] != '[') ++pos;
-    ++pos;
-    while (pos < json_str.size()) {
-        if (!isspace(json_str[pos]) && json_str[pos] != ']') {
-            array_value.push_back(parse_value(json_str, pos));
+void JSON::dump(string &out, int indent) const {
+    dump_value(out, indent, 0);
+}
+
+/* 元素个数达到该值的数组和对象才分段并行序列化 */
+static constexpr size_t PARALLEL_DUMP_THRESHOLD = 4096;
+
+/* 并行序列化的一段输出：node为空时是固定的文本（括号、逗号、缩进和键），
+ * 否则是容器node（位于第depth层）的第begin到end-1个元素，由工作线程格式化到text中 */
+struct JSON::DumpSegment {
+    string text;
+    const JSON *node = nullptr;
+    size_t begin = 0;
+    size_t end = 0;
+    int depth = 0;
+    bool ready = false;
+};
+
+/* 把非空的容器json拆成若干段。元素很多的容器按元素个数均匀分段；顶层的元素较少时，其中元素很多的子容器
+ * （如{"meta": ..., "records": [...]}中的records）再按同样的方式分段，其余元素各自成段 */
+void JSON::plan_dump(int indent, int depth, size_t chunk, vector<DumpSegment> &segments) const {
+    auto literal = [&segments](string text) {
+        if (segments.empty() || segments.back().node) segments.emplace_back();
+        segments.back().text += text;
+        segments.back().ready = true;
+    };
+    auto elements = [&](size_t begin, size_t end) {
+        for (; begin < end; begin += chunk) {
+            DumpSegment &segment = segments.emplace_back();
+            segment.node = this;
+            segment.begin = begin;
+            segment.end = std::min(begin + chunk, end);
+            segment.depth = depth;
         }
-        ++pos;
+    };
+    size_t size = JSONSize(*this);
+    literal(type == JSON_ARRAY_TYPE ? "[" : "{");
+    if (size >= PARALLEL_DUMP_THRESHOLD || depth > 0) {
+        elements(0, size);
+    } else {
+        size_t begin = 0;
+        for (size_t i = 0; i < size; ++i) {
+            const JSON &value = type == JSON_ARRAY_TYPE ? array_data->values[i] : object_data->members[i].value;
+            if (value.type < JSON_ARRAY_TYPE || JSONSize(value) < PARALLEL_DUMP_THRESHOLD) continue;
+            elements(begin, i);
+            string prefix;
+            dump_member_prefix(prefix, indent, depth, i);
+            literal(prefix);
+            value.plan_dump(indent, depth + 1, chunk, segments);
+            begin = i + 1;
+        }
+        elements(begin, size);
+    }
+    string suffix;
+    if (indent >= 0) append_newline(suffix, indent, depth);
+    suffix.push_back(type == JSON_ARRAY_TYPE ? ']' : '}');
+    literal(suffix);
+}
+
+/* 工作线程按顺序领取各段并格式化，调用者的线程按顺序把完成的段交给sink后释放。
+ * 工作线程最多领先一个窗口，因此同时存在的输出缓冲区有上限 */
+void JSON::dump_segments(int indent, unsigned threads, const std::function<void(string &)> &sink) const {
+    if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+    materialize();
+    vector<DumpSegment> segments;
+    if (threads > 1 && type >= JSON_ARRAY_TYPE && JSONSize(*this) > 0) {
+        size_t chunk = std::max<size_t>(JSONSize(*this) / (threads * 8), PARALLEL_DUMP_THRESHOLD / 4);
+        plan_dump(indent, 0, chunk, segments);
+    }
+    size_t tasks = std::count_if(segments.begin(), segments.end(), [](const DumpSegment &s) { return s.node; });
+    if (tasks < 2) {
+        string out;
+        dump_value(out, indent, 0);
+        return sink(out);
+    }
+    // 延迟解析的容器在访问时从文档的内存池中分配，工作线程不能并发地解析，先在本线程解析完整棵树
+    materialize_tree();
+    size_t window = threads * 4;
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t next = 0, emitted = 0;
+    bool stopped = false;
+    auto work = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            changed.wait(lock, [&]() { return stopped || next == segments.size() || next < emitted + window; });
+            if (stopped || next == segments.size()) return;
+            DumpSegment &segment = segments[next++];
+            if (segment.ready) continue;
+            lock.unlock();
+            segment.node->dump_members(segment.text, indent, segment.depth, segment.begin, segment.end);
+            lock.lock();
+            segment.ready = true;
+            changed.notify_all();
+        }
+    };
+    vector<std::thread> workers;
+    // 无论正常结束还是sink抛出异常，都先让工作线程退出再返回
+    struct Stop {
+        std::mutex &mutex;
+        std::condition_variable &changed;
+        bool &stopped;
+        vector<std::thread> &workers;
+
+        ~Stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopped = true;
+            }
+            changed.notify_all();
+            for (auto &worker: workers) worker.join();
+        }
+    } stop{mutex, changed, stopped, workers};
+    for (size_t i = 0; i < std::min<size_t>(threads, tasks); ++i) workers.emplace_back(work);
+    for (DumpSegment &segment: segments) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&segment]() { return segment.ready; });
+        }
+        sink(segment.text);
+        string().swap(segment.text);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++emitted;
+        }
+        changed.notify_all();
     }
 }
 
-/* 拷贝构造函数，实现值拷贝 */
-JSONArray::JSONArray(const JSONArray &cj) : BaseValue(cj.value_type) {
-    *this = cj;   // 调用拷贝赋值运算符
+string JSON::dump_parallel(int indent, unsigned threads) const {
+    string out;
+    dump_segments(indent, threads, [&out](string &piece) {
+        if (out.empty()) out = std::move(piece);
+        else out += piece;
+    });
+    return out;
 }
 
-/* 拷贝赋值运算符，实现值拷贝 */
-JSONArray &JSONArray::operator=(const JSONArray &cj) {
-    this->array_value.clear();
-    for (const auto &i: cj.array_value) {
-        this->array_value.push_back(make_shared<JSON>(*i));
-    }
-    return *this;
+void JSON::dump_parallel(ostream &out, int indent, unsigned threads) const {
+    dump_segments(indent, threads, [&out](string &piece) { out.write(piece.data(), piece.size()); });
 }
 
-void JSONArray::push_back(const char value[]) {
-    array_value.push_back(make_shared<JSON>(JSON::Value(std::in_place_type<StringValue>, value)));
+/* 写入流时缓冲区达到该大小就写出一次 */
+static constexpr size_t MSGPACK_FLUSH_SIZE = 1 << 16;
+
+/* 从流中读取声明的长度时每次最多读取的字节数，缓冲区随读到的字节增长，不按不可信的长度一次分配 */
+static constexpr size_t MSGPACK_READ_CHUNK = 1 << 16;
+
+/* 追加标记字节marker，之后是value按大端序的低bytes个字节 */
+static void append_big_endian(string &out, unsigned char marker, unsigned long long value, int bytes) {
+    char buffer[9];
+    buffer[0] = static_cast<char>(marker);
+    for (int i = 0; i < bytes; ++i) buffer[1 + i] = static_cast<char>(value >> (8 * (bytes - 1 - i)));
+    out.append(buffer, 1 + bytes);
 }
 
-void JSONArray::push_back(const long double &value) {
-    array_value.push_back(make_shared<JSON>(JSON::Value(std::in_place_type<FloatValue>, value)));
+static void append_msgpack_uint(string &out, unsigned long long value) {
+    if (value < 0x80) out.push_back(static_cast<char>(value));
+    else if (value <= UINT8_MAX) append_big_endian(out, 0xCC, value, 1);
+    else if (value <= UINT16_MAX) append_big_endian(out, 0xCD, value, 2);
+    else if (value <= UINT32_MAX) append_big_endian(out, 0xCE, value, 4);
+    else append_big_endian(out, 0xCF, value, 8);
 }
 
-void JSONArray::push_back(const double &value) {
-    array_value.push_back(make_shared<JSON>(JSON::Value(std::in_place_type<FloatValue>, value)));
+static void append_msgpack_int(string &out, long long value) {
+    if (value >= 0) append_msgpack_uint(out, static_cast<unsigned long long>(value));
+    else if (value >= -32) out.push_back(static_cast<char>(value));
+    else if (value >= INT8_MIN) append_big_endian(out, 0xD0, static_cast<unsigned long long>(value), 1);
+    else if (value >= INT16_MIN) append_big_endian(out, 0xD1, static_cast<unsigned long long>(value), 2);
+    else if (value >= INT32_MIN) append_big_endian(out, 0xD2, static_cast<unsigned long long>(value), 4);
+    else append_big_endian(out, 0xD3, static_cast<unsigned long long>(value), 8);
 }
 
-void JSONArray::push_back(const long long &value) {
-    array_value.push_back(make_shared<JSON>(JSON::Value(std::in_place_type<IntValue>, value)));
+/* 字符串、数组和对象的长度：小于fix_limit时并入fix标记的低位，否则依次使用8位（marker8为0时没有）、
+ * 16位和32位长度，32位长度的标记是16位的下一个 */
+static void append_msgpack_size(string &out, size_t size, unsigned char fix, size_t fix_limit,
+                                unsigned char marker8, unsigned char marker16) {
+    if (size < fix_limit) out.push_back(static_cast<char>(fix | size));
+    else if (marker8 && size <= UINT8_MAX) append_big_endian(out, marker8, size, 1);
+    else if (size <= UINT16_MAX) append_big_endian(out, marker16, size, 2);
+    else if (size <= UINT32_MAX) append_big_endian(out, marker16 + 1, size, 4);
+    else throw std::runtime_error("Value too large for MessagePack");
 }
 
-void JSONArray::push_back(const int &value) {
-    array_value.push_back(make_shared<JSON>(JSON::Value(std::in_place_type<IntValue>, value)));
+/* 单遍编码，除了输出缓冲区增长外不分配内存 */
+void JSON::pack_msgpack(string &out, ostream *stream) const {
+    materialize();
+    switch (type) {
+        case STRING_TYPE: {
+            std::string_view value = string_value();
+            append_msgpack_size(out, value.size(), 0xA0, 32, 0xD9, 0xDA);
+            out.append(value);
+            break;
+        }
+        case INT_TYPE:
+            if (is_unsigned()) append_msgpack_uint(out, static_cast<unsigned long long>(integer_value()));
+            else append_msgpack_int(out, integer_value());
+            break;
+        case FLOAT_TYPE: {
+            double value = floating_value();
+            unsigned long long bits;
+            std::memcpy(&bits, &value, sizeof bits);
+            append_big_endian(out, 0xCB, bits, 8);
+            break;
+        }
+        case BOOL_TYPE:
+            out.push_back(bool_value ? '\xC3' : '\xC2');
+            break;
+        case NULL_TYPE:
+            out.push_back('\xC0');
+            break;
+        case JSON_ARRAY_TYPE:
+            append_msgpack_size(out, JSONSize(*this), 0x90, 16, 0, 0xDC);
+            if (array_data)
+                for (const auto &value: array_data->values) value.pack_msgpack(out, stream);
+            break;
+        case JSON_OBJECT_TYPE:
+            append_msgpack_size(out, JSONSize(*this), 0x80, 16, 0, 0xDE);
+            if (object_data)
+                for (const auto &member: object_data->members) {
+                    member.key.pack_msgpack(out, stream);
+                    member.value.pack_msgpack(out, stream);
+                }
+            break;
+    }
+    if (stream && out.size() >= MSGPACK_FLUSH_SIZE) {
+        stream->write(out.data(), static_cast<std::streamsize>(out.size()));
+        out.clear();
+    }
 }
 
-void JSONArray::push_back(const bool &value) {
-    array_value.push_back(make_shared<JSON>(JSON::Value(std::in_place_type<BoolValue>, value)));
+string JSON::dump_msgpack() const {
+    string out;
+    pack_msgpack(out, nullptr);
+    return out;
 }
 
-void JSONArray::push_back(std::nullptr_t value) {
-    array_value.push_back(make_shared<JSON>(JSON::Value(std::in_place_type<NULLValue>)));
+void JSON::dump_msgpack(string &out) const {
+    pack_msgpack(out, nullptr);
 }
 
-void JSONArray::push_back(const JSON &json) {
-    array_value.push_back(make_shared<JSON>(json));
+void JSON::dump_msgpack(ostream &out) const {
+    string buffer;
+    buffer.reserve(MSGPACK_FLUSH_SIZE);
+    pack_msgpack(buffer, &out);
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
 }
 
-ostream &operator<<(ostream &out, const JSONArray &json_array) {
-    out << "[";
-    size_t i = 0;
-    for (; i < json_array.array_value.size(); ++i) {
-        std::visit([&out](const auto &v) {
-            out << v;
-        }, (*json_array.array_value[i]).value);
-        if (i != json_array.array_value.size() - 1) {
-            out << ",";
+/* MessagePack的输入：data中的缓冲区，或者stream不为空时从流中按需读取，不多读 */
+struct JSON::MsgpackReader {
+    std::string_view data;
+    size_t pos = 0;
+    std::streambuf *stream = nullptr;
+    string scratch;     // 从流中读出的字节，每次读取都复用
+    size_t depth = 0;
+    bool next_is_key = false;   // 下一个值是对象的键，是字符串时存入键字典
+    KeyDictionary keys;
+
+    // 取出接下来的n个字节，返回的指针在下一次读取之前有效
+    const char *take(size_t n) {
+        if (!stream) {
+            if (data.size() - pos < n) throw std::runtime_error("Unexpected end of MessagePack data");
+            pos += n;
+            return data.data() + pos - n;
+        }
+        scratch.clear();
+        while (scratch.size() < n) {
+            size_t offset = scratch.size(), chunk = std::min(n - offset, MSGPACK_READ_CHUNK);
+            scratch.resize(offset + chunk);
+            if (static_cast<size_t>(stream->sgetn(&scratch[offset], static_cast<std::streamsize>(chunk))) != chunk)
+                throw std::runtime_error("Unexpected end of MessagePack data");
         }
+        return scratch.data();
     }
-    out << "]";
-    return out;
-}
 
-JSON &JSONArray::operator[](const int &pos) {
-    if (pos > -1 && pos < array_value.size()) {
-        return *array_value[pos];
-    } else {
-        throw std::out_of_range("Index out of range");
+    unsigned long long big_endian(size_t bytes) {
+        const char *p = take(bytes);
+        unsigned long long value = 0;
+        for (size_t i = 0; i < bytes; ++i) value = value << 8 | static_cast<unsigned char>(p[i]);
+        return value;
     }
-}
 
-ostream &operator<<(ostream &out, const StringValue &string_value) {
-    out << "\"" << string_value.value << "\"";
-    return out;
+    // 预留的元素个数。每个元素至少占bytes个字节，剩余的输入不够时直接报错；流的长度未知时只预留一部分
+    size_t reserve_limit(size_t size, size_t bytes) const {
+        if (stream) return std::min(size, size_t(4096));
+        if ((data.size() - pos) / bytes < size) throw std::runtime_error("Unexpected end of MessagePack data");
+        return size;
+    }
+};
+
+/* 数组和对象直接构造出存储，按声明的元素个数一次预留 */
+JSON JSON::unpack_msgpack(MsgpackReader &reader, std::pmr::memory_resource *resource) {
+    auto marker = static_cast<unsigned char>(*reader.take(1));
+    bool is_key = reader.next_is_key;
+    reader.next_is_key = false;
+    auto store_string = [&](JSON &json, std::string_view value) {
+        if (is_key)
+            reader.keys.store(json, value, resource);
+        else
+            json.set_string(value, resource);
+    };
+    JSON json;
+    size_t size = 0;
+    unsigned char container = 0;
+    if (marker <= 0x7F) {
+        json = static_cast<long long>(marker);
+    } else if (marker >= 0xE0) {
+        json = static_cast<long long>(static_cast<signed char>(marker));
+    } else if (marker <= 0x8F) {
+        container = JSON_OBJECT_TYPE;
+        size = marker & 0x0F;
+    } else if (marker <= 0x9F) {
+        container = JSON_ARRAY_TYPE;
+        size = marker & 0x0F;
+    } else if (marker <= 0xBF) {
+        size = marker & 0x1F;
+        store_string(json, std::string_view(reader.take(size), size));
+    } else {
+        switch (marker) {
+            case 0xC0: break;
+            case 0xC2: json = false; break;
+            case 0xC3: json = true; break;
+            case 0xC4: case 0xC5: case 0xC6:    // bin 8/16/32
+            case 0xD9: case 0xDA: case 0xDB:    // str 8/16/32
+                size = reader.big_endian(size_t(1) << (marker >= 0xD9 ? marker - 0xD9 : marker - 0xC4));
+                store_string(json, std::string_view(reader.take(size), size));
+                break;
+            case 0xCA: {
+                auto bits = static_cast<uint32_t>(reader.big_endian(4));
+                float value;
+                std::memcpy(&value, &bits, sizeof value);
+                json = static_cast<double>(value);
+                break;
+            }
+            case 0xCB: {
+                unsigned long long bits = reader.big_endian(8);
+                double value;
+                std::memcpy(&value, &bits, sizeof value);
+                json = value;
+                break;
+            }
+            case 0xCC: case 0xCD: case 0xCE: case 0xCF:     // uint 8/16/32/64
+                json = reader.big_endian(size_t(1) << (marker - 0xCC));
+                break;
+            case 0xD0: json = static_cast<long long>(static_cast<int8_t>(reader.big_endian(1))); break;
+            case 0xD1: json = static_cast<long long>(static_cast<int16_t>(reader.big_endian(2))); break;
+            case 0xD2: json = static_cast<long long>(static_cast<int32_t>(reader.big_endian(4))); break;
+            case 0xD3: json = static_cast<long long>(reader.big_endian(8)); break;
+            case 0xDC: case 0xDD:
+                container = JSON_ARRAY_TYPE;
+                size = reader.big_endian(marker == 0xDC ? 2 : 4);
+                break;
+            case 0xDE: case 0xDF:
+                container = JSON_OBJECT_TYPE;
+                size = reader.big_endian(marker == 0xDE ? 2 : 4);
+                break;
+            default:
+                throw std::runtime_error("Unsupported MessagePack type");
+        }
+    }
+    if (!container) return json;
+    json = empty_container(container);
+    if (size == 0) return json;
+    if (++reader.depth > MAX_DEPTH) throw std::runtime_error("MessagePack nesting too deep");
+    if (container == JSON_ARRAY_TYPE) {
+        json.array_data = new_block<JSONArray>(resource);
+        auto &values = json.array_data->values;
+        values.reserve(reader.reserve_limit(size, 1));
+        for (size_t i = 0; i < size; ++i) values.push_back(unpack_msgpack(reader, resource));
+    } else {
+        json.object_data = new_block<JSONObject>(resource);
+        auto &members = json.object_data->members;
+        members.reserve(reader.reserve_limit(size, 2));
+        for (size_t i = 0; i < size; ++i) {
+            reader.next_is_key = true;
+            JSON key = unpack_msgpack(reader, resource);
+            if (key.type != STRING_TYPE) throw std::runtime_error("MessagePack map key is not a string");
+            JSON value = unpack_msgpack(reader, resource);
+            members.push_back({std::move(key), std::move(value)});
+        }
+        json.object_data->rebuild_index();
+    }
+    --reader.depth;
+    return json;
 }
 
-ostream &operator<<(ostream &out, const IntValue &int_value) {
-    out << int_value.value;
-    return out;
+JSON JSON::parse_msgpack(const string &data) {
+    MsgpackReader reader;
+    reader.data = data;
+    JSON json = unpack_msgpack(reader, std::pmr::get_default_resource());
+    if (reader.pos != data.size()) throw std::runtime_error("Unexpected bytes after MessagePack value");
+    return json;
 }
 
-ostream &operator<<(ostream &out, const FloatValue &float_value) {
-    out << float_value.value;
-    return out;
+JSON JSON::parse_msgpack(istream &in) {
+    MsgpackReader reader;
+    reader.stream = in.rdbuf();
+    return unpack_msgpack(reader, std::pmr::get_default_resource());
 }
 
-ostream &operator<<(ostream &out, const BoolValue &bool_value) {
-    if (bool_value.value)
-        out << "true";
-    else
-        out << "false";
+ostream &operator<<(ostream &out, const JSON &json) {
+    json.materialize();
+    switch (json.type) {
+        case STRING_TYPE:
+            write_string(out, json.string_value());
+            break;
+        case INT_TYPE:
+            if (json.short_size == JSON::NUMBER_TEXT)
+                out << json.number_text();
+            else if (json.is_unsigned())
+                out << static_cast<unsigned long long>(json.int_value);
+            else
+                out << json.int_value;
+            break;
+        case FLOAT_TYPE:
+            if (json.short_size == JSON::NUMBER_TEXT)
+                out << json.number_text();
+            else
+                out << json.float_value;
+            break;
+        case BOOL_TYPE:
+            out << (json.bool_value ? "true" : "false");
+            break;
+        case NULL_TYPE:
+            out << "null";
+            break;
+        case JSON_ARRAY_TYPE:
+            out << "[";
+            if (json.array_data) {
+                const auto &values = json.array_data->values;
+                for (size_t i = 0; i < values.size(); ++i) {
+                    out << values[i];
+                    if (i != values.size() - 1) out << ",";
+                }
+            }
+            out << "]";
+            break;
+        case JSON_OBJECT_TYPE:
+            out << "{";
+            if (json.object_data) {
+                const auto &members = json.object_data->members;
+                for (size_t i = 0; i < members.size(); ++i) {
+                    write_string(out, members[i].key.string_value());
+                    out << ":" << members[i].value;
+                    if (i != members.size() - 1) out << ",";
+                }
+            }
+            out << "}";
+            break;
+    }
     return out;
 }
 
-ostream &operator<<(ostream &out, const NULLValue &null_value) {
-    out << "null";
-    return out;
+/* 根据当前状态处理一个值的第一个字符：容器直接入栈，标量开始一个记号 */
+void JSONStreamParser::start_value(char c) {
+    if (c == '{' || c == '[') {
+        // 解析本身不递归，但构造出的树在析构和序列化时递归，层数限制与其他解析函数相同
+        if (stack.size() == MAX_DEPTH) throw std::runtime_error(JSONParseError{JSONErrorCode::TOO_DEEP, 0}.message());
+        JSON container = JSON::empty_container(c == '{' ? JSON_OBJECT_TYPE : JSON_ARRAY_TYPE);
+        JSON *node;
+        if (stack.empty()) {
+            target = std::move(container);
+            node = &target;
+        } else {
+            node = attach(std::move(container));
+        }
+        stack.push_back({node, c == '{' ? OBJECT_START : ARRAY_START, JSON()});
+        return;
+    }
+    if (stack.empty()) throw std::runtime_error("Unqualified JSON string");
+    pending.assign(1, c);
+    token_is_key = false;
+    token_escaped = false;
+    if (c == '"') token = STRING_TOKEN;
+    else if (is_digit(c) || c == '-' || c == '+') token = NUMBER_TOKEN;
+    else if (c >= 'a' && c <= 'z') token = LITERAL_TOKEN;
+    else throw std::runtime_error("Unqualified JSON value");
+}
+
+/* 从data[i]继续读取当前记号，返回处理到的位置。记号在本块内结束时调用finish_token */
+size_t JSONStreamParser::continue_token(const char *data, size_t size, size_t i) {
+    if (token == STRING_TOKEN) {
+        while (i < size) {
+            if (token_escaped) {
+                pending.push_back(data[i++]);
+                token_escaped = false;
+                continue;
+            }
+            size_t end = i + scan_kernels().find_quote_or_escape(data + i, size - i);
+            pending.append(data + i, end - i);
+            if (end == size) return size;
+            pending.push_back(data[end]);
+            i = end + 1;
+            if (data[end] == '"') {
+                finish_token();
+                return i;
+            }
+            token_escaped = true;
+        }
+        return i;
+    }
+    size_t end = i;
+    if (token == NUMBER_TOKEN) {
+        while (end < size && (is_digit(data[end]) || data[end] == '.' || data[end] == 'e' || data[end] == 'E' ||
+                              data[end] == '-' || data[end] == '+'))
+            ++end;
+    } else {
+        while (end < size && data[end] >= 'a' && data[end] <= 'z') ++end;
+    }
+    pending.append(data + i, end - i);
+    if (end < size) finish_token();
+    return end;
 }
 
 
-JSON::JSON(const string &str) : value(std::in_place_type<JSONObject>, "{}") {
+/* 记号结束：键保存在当前层中，值挂到当前容器上 */
+void JSONStreamParser::finish_token() {
     size_t pos = 0;
-    while (isspace(str[pos])) ++pos;
-    if (str[pos] == '{') {
-        value.emplace<JSONObject>(str);
-    } else if (str[pos] == '[') {
-        value.emplace<JSONArray>(str);
+    if (token_is_key) {
+        ScanState state;
+        std::string_view key = scan_string(pending, pos, state);
+        state.check();
+        keys.store(stack.back().key, key, std::pmr::get_default_resource());
+        stack.back().state = OBJECT_COLON;
+    } else {
+        JSON node = parse_value(pending, pos);
+        if (pos != pending.size()) throw std::runtime_error("Unqualified JSON value");
+        attach(std::move(node));
+    }
+    token = NO_TOKEN;
+}
+
+/* 将子节点加入栈顶的容器，返回它在容器中的位置。容器只在子容器结束之后才会追加元素，
+ * 因此栈中保存的位置在子容器解析期间一直有效 */
+JSON *JSONStreamParser::attach(JSON &&node) {
+    Frame &frame = stack.back();
+    if (frame.state == OBJECT_VALUE) {
+        JSONObject &object = frame.node->mutable_object();
+        object.members.push_back({std::move(frame.key), std::move(node)});
+        object.index_last_key();
+        frame.state = OBJECT_NEXT;
+        return &object.members.back().value;
     } else {
-        throw std::runtime_error("Unqualified JSON string");
+        JSONArray &array = frame.node->mutable_array();
+        array.values.push_back(std::move(node));
+        frame.state = ARRAY_NEXT;
+        return &array.values.back();
     }
 }
 
-ostream &operator<<(ostream &out, const JSON &json) {
-    std::visit([&out](const auto &v) {
-        out << v;
-    }, json.value);
-    return out;
+void JSONStreamParser::feed(const char *data, size_t size) {
+    size_t i = 0;
+    while (i < size) {
+        if (token != NO_TOKEN) {
+            i = continue_token(data, size, i);
+            continue;
+        }
+        char c = data[i];
+        if (is_whitespace(c)) {
+            ++i;
+            continue;
+        }
+        if (completed) throw std::runtime_error("Unexpected characters after JSON value");
+        ++i;
+        if (stack.empty()) {
+            start_value(c);
+            continue;
+        }
+        Frame &frame = stack.back();
+        switch (frame.state) {
+            case ARRAY_START:
+            case OBJECT_START:
+                if (c == (frame.state == ARRAY_START ? ']' : '}')) {
+                    stack.pop_back();
+                    completed = stack.empty();
+                    break;
+                }
+                if (frame.state == ARRAY_START) {
+                    frame.state = ARRAY_VALUE;
+                    start_value(c);
+                    break;
+                }
+                // fall through
+            case OBJECT_KEY:
+                if (c != '"') throw std::runtime_error("Expected a key in JSON object");
+                frame.state = OBJECT_KEY;
+                start_value(c);
+                token_is_key = true;
+                break;
+            case OBJECT_COLON:
+                if (c != ':') throw std::runtime_error("Expected ':' in JSON object");
+                frame.state = OBJECT_VALUE;
+                break;
+            case ARRAY_VALUE:
+            case OBJECT_VALUE:
+                start_value(c);
+                break;
+            case ARRAY_NEXT:
+            case OBJECT_NEXT:
+                if (c == ',') {
+                    frame.state = frame.state == ARRAY_NEXT ? ARRAY_VALUE : OBJECT_KEY;
+                } else if (c == (frame.state == ARRAY_NEXT ? ']' : '}')) {
+                    stack.pop_back();
+                    completed = stack.empty();
+                } else {
+                    throw std::runtime_error(frame.state == ARRAY_NEXT ? "Expected ',' or ']' in JSON array"
+                                                                       : "Expected ',' or '}' in JSON object");
+                }
+                break;
+        }
+    }
 }
 
+void JSONStreamParser::finish() {
+    if (!completed) throw std::runtime_error("Incomplete JSON input");
+}
+
+/* 输入为JSON对象或数组时分块送入增量解析器，不把整个流读入内存；否则按标量或字符串处理 */
 istream &operator>>(istream &in, JSON &json) {
+    std::streambuf *buf = in.rdbuf();
+    string leading;     // 前导空白，输入不是JSON对象（数组）时保留在字符串中
+    int c = buf->sgetc();
+    while (c != EOF && is_whitespace(static_cast<char>(c))) {
+        leading.push_back(static_cast<char>(c));
+        c = buf->snextc();
+    }
+    if (c == '{' || c == '[') {
+        JSONStreamParser parser(json);
+        char chunk[1 << 16];
+        std::streamsize n;
+        while ((n = buf->sgetn(chunk, sizeof chunk)) > 0) parser.feed(chunk, static_cast<size_t>(n));
+        parser.finish();
+        return in;
+    }
     // 正则表达式匹配整数（包括可选的正负号）
     std::regex int_regex("^[+-]?\\d+$");
     // 正则表达式匹配浮点数（包括可选的正负号）
     std::regex float_regex("^[+-]?\\d*\\.\\d+$");
-    string input(string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>()));
+    string input(leading + string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>()));
     if (std::regex_match(input, int_regex)) {
         json = stoll(input);
     } else if (std::regex_match(input, float_regex)) {
         json = stold(input);
     } else {
-        try {
-            json = JSON(input);
-        } catch (const std::runtime_error &e) {
-            json = input;
-        }
+        json = input;
     }
     return in;
 }
 
+
 JSON &JSON::operator[](const string &key) {
-    return std::visit([this, key](const auto &v) -> JSON & {
-        if (v.valueType() == JSON_OBJECT_TYPE) {
-            auto &json_object = std::get<JSONObject>(this->value);
-            return json_object[key];
-        } else {
-            throw std::runtime_error("This object cannot be indexed with a string");
-        }
-    }, value);
+    if (type != JSON_OBJECT_TYPE) throw std::runtime_error("This object cannot be indexed with a string");
+    JSONObject &object = mutable_object();
+    size_t pos = object.find_key(key);
+    if (pos != object.members.size()) return object.members[pos].value;
+    object.members.emplace_back().key.set_string(key, object.resource);
+    object.index_last_key();
+    return object.members.back().value;
 }
 
 JSON &JSON::operator[](const char str[]) {
@@ -314,72 +3026,151 @@ JSON &JSON::operator[](const char str[]) {
 }
 
 JSON &JSON::at(const string &key) {
-    return std::visit([this, key](const auto &v) -> JSON & {
-        if (v.valueType() == JSON_OBJECT_TYPE) {
-            auto &json_object = std::get<JSONObject>(this->value);
-            return json_object.at(key);
-        } else {
-            throw std::runtime_error("This object cannot be indexed with a string");
-        }
-    }, value);
+    if (type != JSON_OBJECT_TYPE) throw std::runtime_error("This object cannot be indexed with a string");
+    materialize();
+    if (object_data) {
+        size_t pos = object_data->find_key(key);
+        if (pos != object_data->members.size()) return mutable_object().members[pos].value;
+    }
+    throw std::out_of_range("The key does not exist");
 }
 
 JSON &JSON::at(const char str[]) {
     return this->at(string(str));
 }
 
-JSON &JSON::operator[](const int &pos) {
-    return std::visit([this, pos](const auto &v) -> JSON & {
-        if (v.valueType() == JSON_ARRAY_TYPE) {
-            auto &json_array = std::get<JSONArray>(this->value);
-            return json_array[pos];
+const JSON &JSON::at(const string &key) const {
+    if (type != JSON_OBJECT_TYPE) throw std::runtime_error("This object cannot be indexed with a string");
+    materialize();
+    if (object_data) {
+        size_t pos = object_data->find_key(key);
+        if (pos != object_data->members.size()) return object_data->members[pos].value;
+    }
+    throw std::out_of_range("The key does not exist");
+}
+
+const JSON &JSON::at(const char str[]) const {
+    return this->at(string(str));
+}
+
+const JSON &JSON::at_pointer(const string &pointer) const {
+    const JSON *json = JSONPointer(pointer).find(*this);
+    if (!json) throw std::out_of_range("The path does not exist");
+    return *json;
+}
+
+JSONPointer::JSONPointer(const string &pointer) {
+    if (!pointer.empty() && pointer[0] != '/') throw std::runtime_error("JSON pointer must start with '/'");
+    for (size_t pos = 0; pos < pointer.size();) {
+        size_t end = pointer.find('/', pos + 1);
+        if (end == string::npos) end = pointer.size();
+        Token &token = tokens.emplace_back();
+        for (size_t i = pos + 1; i < end; ++i) {
+            if (pointer[i] != '~') {
+                token.key.push_back(pointer[i]);
+            } else if (i + 1 < end && (pointer[i + 1] == '0' || pointer[i + 1] == '1')) {
+                token.key.push_back(pointer[++i] == '0' ? '~' : '/');
+            } else {
+                throw std::runtime_error("Invalid escape in JSON pointer");
+            }
+        }
+        token.hash = std::hash<std::string_view>()(token.key);
+        // 数组下标是不以0开头的十进制数（0本身除外）；"-"表示最后一个元素之后，查找时总是不存在
+        token.index = NOT_INDEX;
+        const string &key = token.key;
+        if (!key.empty() && key.size() <= 19 && (key[0] != '0' || key.size() == 1) &&
+            std::all_of(key.begin(), key.end(), is_digit))
+            token.index = std::stoull(key);
+        pos = end;
+    }
+}
+
+JSONProjection::JSONProjection(const vector<string> &paths) : fields(1) {
+    if (paths.empty()) throw std::runtime_error("A projection needs at least one path");
+    for (const string &path: paths) {
+        JSONPointer pointer(path);
+        size_t node = 0;
+        for (const auto &token: pointer.tokens) {
+            if (fields[node].whole) break;  // 已经保留了整个值，更深的路径不再需要
+            size_t child = find(node, token.key);
+            if (child == NOT_FOUND) {
+                child = fields.size();
+                fields[node].children.push_back(child);
+                fields.push_back({token.key, false, {}});
+            }
+            node = child;
+        }
+        fields[node].whole = true;
+    }
+}
+
+/* 选中的键通常只有几个，线性查找比哈希更快 */
+size_t JSONProjection::find(size_t node, std::string_view key) const {
+    for (size_t child: fields[node].children) {
+        if (fields[child].key == key) return child;
+    }
+    return NOT_FOUND;
+}
+
+const JSON *JSONPointer::find(const JSON &root) const {
+    const JSON *json = &root;
+    for (const Token &token: tokens) {
+        json->materialize();
+        if (json->type == JSON_OBJECT_TYPE) {
+            const JSONObject *object = json->object_data;
+            if (!object) return nullptr;
+            size_t i = object->find_key(token.key, token.hash);
+            if (i == object->members.size()) return nullptr;
+            json = &object->members[i].value;
+        } else if (json->type == JSON_ARRAY_TYPE) {
+            if (!json->array_data || token.index >= json->array_data->values.size()) return nullptr;
+            json = &json->array_data->values[token.index];
         } else {
-            throw std::runtime_error("This object cannot be indexed with a integers");
+            return nullptr;
         }
-    }, value);
+    }
+    return json;
 }
 
-vector<string> JSON::keys() {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    if (type == JSON_OBJECT_TYPE) {
-        return std::get<JSONObject>(value).keys();
+JSON &JSON::operator[](const int &pos) {
+    if (type != JSON_ARRAY_TYPE) throw std::runtime_error("This object cannot be indexed with a integers");
+    if (pos > -1 && static_cast<size_t>(pos) < size()) {
+        return mutable_array().values[pos];
+    } else {
+        throw std::out_of_range("Index out of range");
+    }
+}
+
+const JSON &JSON::operator[](const int &pos) const {
+    if (type != JSON_ARRAY_TYPE) throw std::runtime_error("This object cannot be indexed with a integers");
+    if (pos > -1 && static_cast<size_t>(pos) < size()) {
+        return array_data->values[pos];
     } else {
-        throw std::runtime_error("The object does not have keys() function");
+        throw std::out_of_range("Index out of range");
+    }
+}
+
+vector<string> JSON::keys() const {
+    if (type != JSON_OBJECT_TYPE) throw std::runtime_error("The object does not have keys() function");
+    materialize();
+    vector<string> result;
+    if (object_data) {
+        result.reserve(object_data->members.size());
+        for (const auto &member: object_data->members) result.emplace_back(member.key.string_value());
     }
+    return result;
 }
 
 bool JSONisEmpty(const JSON &json) {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, json.value);
-    if (type == JSON_OBJECT_TYPE) {
-        const auto &json_object = std::get<JSONObject>(json.value);
-        if (json_object.object_key.empty() && json_object.object_value.empty())
-            return true;
-        else
-            return false;
-    } else if (type == JSON_ARRAY_TYPE) {
-        const auto &json_array = std::get<JSONArray>(json.value);
-        if (json_array.array_value.empty())
-            return true;
-        else
-            return false;
-    } else
-        throw std::runtime_error("Unrecognized type");
+    return JSONSize(json) == 0;
 }
 
 size_t JSONSize(const JSON &json) {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, json.value);
-    if (type == JSON_OBJECT_TYPE) {
-        const auto &json_object = std::get<JSONObject>(json.value);
-        return json_object.object_key.size();
-    } else if (type == JSON_ARRAY_TYPE) {
-        const auto &json_array = std::get<JSONArray>(json.value);
-        return json_array.array_value.size();
+    json.materialize();
+    if (json.type == JSON_OBJECT_TYPE) {
+        return json.object_data ? json.object_data->members.size() : 0;
+    } else if (json.type == JSON_ARRAY_TYPE) {
+        return json.array_data ? json.array_data->values.size() : 0;
     } else
         throw std::runtime_error("Unrecognized type");
 }
@@ -393,257 +3184,236 @@ size_t JSON::size() const {
 }
 
 JSON &JSON::operator=(const string &v) {
-    value.emplace<StringValue>(v);
+    set_string(v, std::pmr::get_default_resource());
     return *this;
 }
 
 JSON &JSON::operator=(const char v[]) {
-    value.emplace<StringValue>(v);
+    set_string(v, std::pmr::get_default_resource());
     return *this;
 }
 
 JSON &JSON::operator=(const long double &v) {
-    value.emplace<FloatValue>(v);
-    return *this;
+    return *this = static_cast<double>(v);
 }
 
 JSON &JSON::operator=(const double &v) {
-    value.emplace<FloatValue>(v);
+    release();
+    type = FLOAT_TYPE;
+    float_value = v;
     return *this;
 }
 
 JSON &JSON::operator=(const long long &v) {
-    value.emplace<IntValue>(v);
+    release();
+    type = INT_TYPE;
+    int_value = v;
     return *this;
 }
 
-JSON &JSON::operator=(const int &v) {
-    value.emplace<IntValue>(v);
+JSON &JSON::operator=(const unsigned long long &v) {
+    release();
+    type = INT_TYPE;
+    int_value = static_cast<long long>(v);
+    if (v > static_cast<unsigned long long>(std::numeric_limits<long long>::max())) short_size = UNSIGNED_INTEGER;
     return *this;
 }
 
+JSON &JSON::operator=(const int &v) {
+    return *this = static_cast<long long>(v);
+}
+
 JSON &JSON::operator=(const bool &v) {
-    value.emplace<BoolValue>(v);
+    release();
+    type = BOOL_TYPE;
+    bool_value = v;
     return *this;
 }
 
 JSON &JSON::operator=(std::nullptr_t v) {
-    value.emplace<NULLValue>();
+    release();
     return *this;
 }
 
 JSON &JSON::operator=(const JSON &json) {
-    std::visit([&json, this](const auto &v) {
-        switch (v.valueType()) {
-            case STRING_TYPE: {
-                this->value.emplace<StringValue>(std::get<StringValue>(json.value));
-                break;
-            }
-            case INT_TYPE: {
-                this->value.emplace<IntValue>(std::get<IntValue>(json.value));
-                break;
-            }
-            case FLOAT_TYPE: {
-                this->value.emplace<FloatValue>(std::get<FloatValue>(json.value));
-                break;
-            }
-            case BOOL_TYPE: {
-                this->value.emplace<BoolValue>(std::get<BoolValue>(json.value));
-                break;
-            }
-            case NULL_TYPE: {
-                this->value.emplace<NULLValue>();
-                break;
-            }
-            case JSON_OBJECT_TYPE: {
-                this->value.emplace<JSONObject>(std::get<JSONObject>(json.value));
-                break;
-            }
-            case JSON_ARRAY_TYPE: {
-                this->value.emplace<JSONArray>(std::get<JSONArray>(json.value));
-                break;
-            }
-            default:
-                throw std::runtime_error("Unrecognized json_value class");
-        }
-    }, json.value);
+    // 先拷贝再替换：json可能是本节点的子孙，直接替换会先把它销毁
+    JSON copy(json);
+    release();
+    steal(copy);
     return *this;
 }
 
-JSON::operator string() const {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    if (type == STRING_TYPE) {
-        return static_cast<string>(std::get<StringValue>(value));
-    } else {
-        throw std::runtime_error("Cannot convert to string type");
-    }
-}
-
-JSON::operator int() const {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    if (type == INT_TYPE) {
-        return static_cast<int>(std::get<IntValue>(value));
-    } else {
-        throw std::runtime_error("Cannot convert to int type");
-    }
+JSON &JSON::operator=(JSON &&json) noexcept {
+    JSON moved(std::move(json));
+    release();
+    steal(moved);
+    return *this;
 }
 
-JSON::operator long long() const {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    if (type == INT_TYPE) {
-        return static_cast<long long>(std::get<IntValue>(value));
-    } else {
-        throw std::runtime_error("Cannot convert to long long type");
-    }
+JSON::operator string() const {
+    if (type != STRING_TYPE) conversion_error("string");
+    return string(string_value());
 }
 
-JSON::operator long double() const {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    if (type == FLOAT_TYPE) {
-        return static_cast<long double>(std::get<FloatValue>(value));
-    } else {
-        throw std::runtime_error("Cannot convert to long double type");
-    }
+void JSON::conversion_error(const char *type_name) {
+    throw std::runtime_error(string("Cannot convert to ") + type_name + " type");
 }
 
-JSON::operator double() const {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    if (type == FLOAT_TYPE) {
-        return static_cast<double>(std::get<FloatValue>(value));
-    } else {
-        throw std::runtime_error("Cannot convert to double type");
-    }
+bool JSON::remove(const string &str) {
+    if (type != JSON_OBJECT_TYPE) throw std::runtime_error("The object does not have removeElement() function");
+    materialize();
+    if (!object_data || object_data->find_key(str) == object_data->members.size()) return false;
+    JSONObject &object = mutable_object();
+    object.members.erase(object.find_key(str));
+    object.rebuild_index();
+    return true;
 }
 
-JSON::operator bool() const {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    if (type == BOOL_TYPE) {
-        return static_cast<bool >(std::get<BoolValue>(value));
-    } else {
-        throw std::runtime_error("Cannot convert to bool type");
-    }
+bool JSON::remove(const char str[]) {
+    return this->remove(string(str));
 }
 
-bool removeElement(JSONObject &json_object, const string &str) {
-    auto it = std::find(json_object.object_key.begin(), json_object.object_key.end(), str);
-    if (it != json_object.object_key.end()) {
-        long long pos = it - json_object.object_key.begin();
-        json_object.object_key.erase(pos + json_object.object_key.begin());
-        json_object.object_value.erase(pos + json_object.object_value.begin());
+bool JSON::pop(int pos) {
+    if (type != JSON_ARRAY_TYPE) throw std::runtime_error("The object does not have popElement() function");
+    if (static_cast<size_t>(pos) < size()) {
+        auto &values = mutable_array().values;
+        values.erase(pos);
         return true;
     } else {
         return false;
     }
 }
 
-bool JSON::remove(const string &str) {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    if (type == JSON_OBJECT_TYPE) {
-        auto &json_object = std::get<JSONObject>(value);
-        return removeElement(json_object, str);
-    } else {
-        throw std::runtime_error("The object does not have removeElement() function");
-    }
-}
-
-bool JSON::remove(const char str[]) {
-    return this->remove(string(str));
+void JSON::push_back(JSON &&json) {
+    if (type != JSON_ARRAY_TYPE) throw std::runtime_error("The object does not have keys() function");
+    JSON moved(std::move(json));    // json可能是本数组的元素，追加时数组会重新分配
+    mutable_array().values.push_back(std::move(moved));
 }
 
-bool popElement(JSONArray &json_array, int pos) {
-    if (pos < json_array.array_value.size()) {
-        json_array.array_value.erase(pos + json_array.array_value.begin());
-        return true;
+/* 合并JSON对象，值按值拷贝到本对象的内存资源中，避免与json（可能属于另一个JSONDocument）共享节点 */
+void JSON::merge_value(const JSON &json) {
+    if (json.type != JSON_OBJECT_TYPE) throw std::runtime_error("Cannot add JSONArray to the JSON object");
+    if (type != JSON_OBJECT_TYPE) throw std::runtime_error("The object does not have merge() function");
+    json.materialize();
+    materialize();
+    if (!json.object_data) return;
+    if (json.object_data == object_data) {
+        JSON copy(json);    // 与自身合并时先拷贝一份，避免插入自身的元素
+        return merge_value(copy);
+    }
+    // json可能是本对象的子孙，修改本对象后不再访问json，只通过它的存储读取
+    const JSONObject &source = *json.object_data;
+    JSONObject &object = mutable_object();
+    object.members.reserve(object.members.size() + source.members.size());
+    for (const auto &member: source.members) {
+        JSONObject::Member &copy = object.members.emplace_back();
+        copy.key.copy_from(member.key, object.resource);
+        copy.value.copy_from(member.value, object.resource);
+    }
+    object.rebuild_index();
+}
+
+void JSON::merge_value(JSON &&json) {
+    if (json.type != JSON_OBJECT_TYPE) throw std::runtime_error("Cannot add JSONArray to the JSON object");
+    if (type != JSON_OBJECT_TYPE) throw std::runtime_error("The object does not have merge() function");
+    if (&json == this) return merge_value(static_cast<const JSON &>(json));
+    // 先取出json的值再修改本对象，json是本对象的子孙时也不受影响。合并之后json为空对象
+    JSON source(std::move(json));
+    source.materialize();
+    if (!source.object_data) return;
+    JSONObject &object = mutable_object();
+    // 值可能分配自source的内存资源，资源不同时转移后会比资源活得更久，只能拷贝
+    if (*object.resource != *source.object_data->resource) return merge_value(source);
+    JSONObject &from = *source.object_data;
+    object.members.reserve(object.members.size() + from.members.size());
+    if (from.refs == 1) {
+        for (auto &member: from.members) object.members.push_back(std::move(member));
     } else {
+        // 存储还被其他快照使用，共享其中的子数组和子对象
+        for (const auto &member: from.members)
+            object.members.push_back({member.key.share(object.resource), member.value.share(object.resource)});
+    }
+    object.rebuild_index();
+}
+
+/* 整数与浮点数按数值比较，其余值要求类型相同。同一个节点或共享同一份存储的容器直接判定相等。
+ * 数字是否保留了原文不影响比较 */
+bool JSONEqual(const JSON &json1, const JSON &json2, bool ignore_key_order) {
+    if (&json1 == &json2) return true;
+    if (json1.type != json2.type) {
+        if (json1.type == INT_TYPE && json2.type == FLOAT_TYPE) {
+            long long value = json1.integer_value();
+            long double integer = json1.is_unsigned() ? static_cast<long double>(static_cast<unsigned long long>(value))
+                                                      : static_cast<long double>(value);
+            return integer == static_cast<long double>(json2.floating_value());
+        }
+        if (json1.type == FLOAT_TYPE && json2.type == INT_TYPE)
+            return JSONEqual(json2, json1, ignore_key_order);
         return false;
     }
-}
-
-bool JSON::pop(int pos) {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    if (type == JSON_ARRAY_TYPE) {
-        auto &json_array = std::get<JSONArray>(value);
-        return popElement(json_array, pos);
-    } else {
-        throw std::runtime_error("The object does not have popElement() function");
+    switch (json1.type) {
+        case INT_TYPE:
+            return json1.integer_value() == json2.integer_value() && json1.is_unsigned() == json2.is_unsigned();
+        case FLOAT_TYPE:
+            return json1.floating_value() == json2.floating_value();
+        case STRING_TYPE:
+            return json1.string_value() == json2.string_value();
+        case BOOL_TYPE:
+            return json1.bool_value == json2.bool_value;
+        case JSON_ARRAY_TYPE: {
+            json1.materialize();
+            json2.materialize();
+            if (json1.array_data == json2.array_data) return true;
+            size_t size = JSONSize(json1);
+            if (size != JSONSize(json2)) return false;
+            for (size_t i = 0; i < size; ++i) {
+                if (!JSONEqual(json1.array_data->values[i], json2.array_data->values[i], ignore_key_order))
+                    return false;
+            }
+            return true;
+        }
+        case JSON_OBJECT_TYPE: {
+            json1.materialize();
+            json2.materialize();
+            if (json1.object_data == json2.object_data) return true;
+            size_t size = JSONSize(json1);
+            if (size != JSONSize(json2)) return false;
+            const auto &members1 = json1.object_data->members, &members2 = json2.object_data->members;
+            if (!ignore_key_order) {
+                for (size_t i = 0; i < size; ++i) {
+                    if (members1[i].key.string_value() != members2[i].key.string_value() ||
+                        !JSONEqual(members1[i].value, members2[i].value, false))
+                        return false;
+                }
+                return true;
+            }
+            // 键可能重复（merge会追加同名的键），json2的每个成员只能与json1的一个成员配对
+            vector<bool> matched(size);
+            for (size_t i = 0; i < size; ++i) {
+                std::string_view key = members1[i].key.string_value();
+                size_t j = i;
+                if (matched[j] || members2[j].key.string_value() != key ||
+                    !JSONEqual(members1[i].value, members2[j].value, true)) {
+                    // 从该键第一次出现处起找一个尚未配对、值相等的同名成员
+                    for (j = json2.object_data->find_key(key); j < size; ++j) {
+                        if (!matched[j] && members2[j].key.string_value() == key &&
+                            JSONEqual(members1[i].value, members2[j].value, true))
+                            break;
+                    }
+                    if (j == size) return false;
+                }
+                matched[j] = true;
+            }
+            return true;
+        }
     }
-}
-
-bool JSON::isString() {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    return type == STRING_TYPE ? true : false;
-}
-
-bool JSON::isInteger() {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    return type == INT_TYPE ? true : false;
-}
-
-bool JSON::isFloat() {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    return type == FLOAT_TYPE ? true : false;
-}
-
-bool JSON::isBool() {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    return type == BOOL_TYPE ? true : false;
-}
-
-bool JSON::isNULL() {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    return type == NULL_TYPE ? true : false;
-}
-
-bool JSON::isJSONObject() {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    return type == JSON_OBJECT_TYPE ? true : false;
-}
-
-bool JSON::isJSONArray() {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    return type == JSON_ARRAY_TYPE ? true : false;
+    return true;    // 都是null
 }
 
 bool operator==(const JSON &json1, const JSON &json2) {
-    std::ostringstream json_ostrm1, json_ostrm2;
-    json_ostrm1 << json1;
-    json_ostrm2 << json2;
-    if (json_ostrm1.str() == json_ostrm2.str())
-        return true;
-    else
-        return false;
+    return JSONEqual(json1, json2);
 }
 
 bool operator!=(const JSON &json1, const JSON &json2) {
     return json1 == json2 ? false : true;
-}
\ No newline at end of file
+}
@@ -6,9 +6,18 @@
 #include <memory>
 #include <utility>
 #include <iostream>
-#include <variant>
 #include <algorithm>
 #include <regex>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <type_traits>
+#include <optional>
+#include <limits>
+#include <memory_resource>
+#include <functional>
+#include <tuple>
 
 using std::string;
 using std::vector;
@@ -30,35 +39,27 @@ class JSONObject;
 
 class JSONArray;
 
-class BaseValue;
-
-class IntValue;
-
-class FloatValue;
-
-class StringValue;
-
-class BoolValue;
+class JSON;
 
-class NULLValue;
+class JSONDocument;
 
-class JSON;
+class JSONTape;
 
-/* 重载 << 操作符 */
-ostream &operator<<(ostream &, const StringValue &);
+class JSONReader;
 
-ostream &operator<<(ostream &, const IntValue &);
+class JSONMappedFile;
 
-ostream &operator<<(ostream &, const FloatValue &);
+class JSONStreamParser;
 
-ostream &operator<<(ostream &, const BoolValue &);
+class JSONHandler;
 
-ostream &operator<<(ostream &, const NULLValue &);
+class JSONPointer;
 
-ostream &operator<<(ostream &, const JSONObject &);
+class JSONProjection;
 
-ostream &operator<<(ostream &, const JSONArray &);
+class JSONParseResult;
 
+/* 重载 << 操作符 */
 ostream &operator<<(ostream &, const JSON &);
 
 /* 重载 >> 操作符 */
@@ -69,342 +70,1319 @@ bool operator==(const JSON &, const JSON &);
 
 bool operator!=(const JSON &, const JSON &);
 
-// 解析JSON值的辅助函数
-shared_ptr<JSON> parse_value(const string &, size_t &pos);
+// 解析JSON值的辅助函数，数组、对象和长字符串的存储从resource中分配
+JSON parse_value(const string &, size_t &pos, std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+// 以事件的方式解析JSON字符串，不构造JSON对象。解析完成返回true，被handler中止返回false
+bool parse_sax(const string &str, JSONHandler &handler);
+
+// 解析按行分隔的JSON（NDJSON / JSON Lines），每行一个JSON值，空行被忽略。输入按行切分成批，由threads个线程
+// （为0时使用硬件线程数）并行解析，callback在调用者的线程中按输入的顺序依次收到每一批记录。返回记录的总数。
+// 某一行不合法时，之前的批次照常交给callback，然后抛出std::runtime_error
+size_t parse_ndjson(const string &text, const std::function<void(vector<JSON> &)> &callback, unsigned threads = 0);
+
+// 同parse_ndjson，文件被映射到内存后直接解析
+size_t parse_ndjson_file(const string &path, const std::function<void(vector<JSON> &)> &callback,
+                         unsigned threads = 0);
+
+// 同parse_ndjson，每条记录按projection解析，只保留其中的字段
+size_t parse_ndjson(const string &text, const JSONProjection &projection,
+                    const std::function<void(vector<JSON> &)> &callback, unsigned threads = 0);
+
+size_t parse_ndjson_file(const string &path, const JSONProjection &projection,
+                         const std::function<void(vector<JSON> &)> &callback, unsigned threads = 0);
+
+/* 解析错误的种类，每种对应一条错误信息，抛出异常的解析函数使用同样的信息 */
+enum class JSONErrorCode {
+    NONE,
+    INVALID_VALUE,              // 不是任何一种值的开头，或字面量拼写错误
+    INVALID_NUMBER,             // 数字不符合语法
+    NUMBER_OUT_OF_RANGE,        // 数字超出int64或double的范围
+    UNTERMINATED_STRING,
+    INVALID_ESCAPE,             // '\\'之后不是合法的转义字符
+    INVALID_UNICODE_ESCAPE,     // \u之后不是4位十六进制数，或者代理项没有成对出现
+    CONTROL_CHARACTER,          // 字符串中未转义的控制字符
+    INVALID_UTF8,               // 字符串中不合法的UTF-8序列
+    EXPECTED_ARRAY_SEPARATOR,   // 数组元素之后不是','或']'
+    EXPECTED_KEY,
+    EXPECTED_COLON,
+    EXPECTED_OBJECT_SEPARATOR,  // 对象的值之后不是','或'}'
+    TRAILING_CHARACTERS,        // 值之后还有非空白字符
+    TOO_DEEP                    // 嵌套层数超过上限
+};
+
+/* 解析错误：错误的种类和在输入中的字节偏移 */
+struct JSONParseError {
+    JSONErrorCode code = JSONErrorCode::NONE;
+    size_t offset = 0;
+
+    const char *message() const;
+};
 
 // JSON辅助函数
 bool JSONisEmpty(const JSON &);
 
 size_t JSONSize(const JSON &);
 
-bool removeElement(JSONObject &json_object, const string &str);
+// 逐层比较两个JSON值，遇到第一个不同之处立即返回。ignore_key_order为true时对象的键的顺序不影响比较结果，重复的键一一配对
+bool JSONEqual(const JSON &, const JSON &, bool ignore_key_order = false);
+
+/* 主JSON类。每个值是一个16字节的节点：1字节的类型标记加上按类型解释的数据。
+ * 整数、浮点数（double）、布尔值和不超过14字节的短字符串直接保存在节点中；长字符串、数组和对象
+ * 保存在单独分配的存储中，节点只保存指向它的指针。数组的元素和对象的值按值连续保存在存储中 */
+class JSON {
+    friend JSON parse_value(const string &, size_t &pos, std::pmr::memory_resource *resource);
 
-bool popElement(JSONArray &json_array, int pos);
+    friend class NDJSONReader;      // parse_ndjson的实现，定义在cppJSON.cpp中
 
-// JSON值的基类
-class BaseValue {
-public:
-    explicit BaseValue(int t) : value_type(t) {};
+    friend ostream &operator<<(ostream &out, const JSON &json_value);
 
-    virtual ~BaseValue() = default;
+    friend istream &operator>>(istream &, JSON &);
 
-    int valueType() const { return value_type; }
+    friend bool JSONisEmpty(const JSON &);
 
-protected:
-    int value_type = -1;    // JSON值的类型
-};
+    friend size_t JSONSize(const JSON &);
 
-/* JSON整数值类 */
-class IntValue : public BaseValue {
-    friend ostream &operator<<(ostream &, const IntValue &);
+    friend bool operator==(const JSON &, const JSON &);
 
-public:
-    explicit IntValue(const long long &v) : BaseValue(INT_TYPE), value(v) {}
+    friend bool operator!=(const JSON &, const JSON &);
 
-    explicit operator long long() const { return value; }
+    friend bool JSONEqual(const JSON &, const JSON &, bool);
 
-    explicit operator int() const { return static_cast<int>(value); }
+    friend class JSONObject;
 
-private:
-    long long value;
+    friend class JSONArray;
 
-};
+    friend class JSONStreamParser;
+
+    friend class JSONPointer;
 
-/* JSON浮点值类 */
-class FloatValue : public BaseValue {
-    friend ostream &operator<<(ostream &, const FloatValue &);
+    friend class JSONDocument;
+
+    friend class JSONTape;
+
+    friend class JSONReader;
 
 public:
-    explicit FloatValue(const long double &v) : BaseValue(FLOAT_TYPE), value(v) {}
+    /* 构造函数 */
+    JSON() noexcept: type(NULL_TYPE), short_size(0), short_string(), int_value(0) {}   // 构造null
 
-    explicit operator long double() const { return value; }
+    explicit JSON(const string &str);
 
-    explicit operator double() const { return static_cast<double>(value); }
+    explicit JSON(const char str[]) : JSON(string(str)) {}
 
-private:
-    long double value;
+    // 解析str，数组、对象和长字符串的存储从resource中分配
+    JSON(const string &str, std::pmr::memory_resource *resource);
 
-};
+    // 将文件映射到内存后直接在映射上解析，不把整个文件读入字符串
+    static JSON parse_file(const string &path);
 
-/* JSON字符串值类 */
-class StringValue : public BaseValue {
-    friend ostream &operator<<(ostream &, const StringValue &);
+    // 多线程解析顶层为数组的大文档，结果与JSON(str)相同。threads为0时使用硬件线程数；
+    // 文档较小或顶层不是数组时单线程解析
+    static JSON parse_parallel(const string &str, unsigned threads = 0);
 
-public:
-    explicit StringValue(const string &v) : BaseValue(STRING_TYPE), value(v) {}
+    // 按RFC 8259严格校验并解析，顶层可以是任意值。除了完整的语法检查外还校验字符串的UTF-8编码和\u代理对，
+    // 限制嵌套层数。出错时不抛出异常，返回错误的种类和位置
+    static JSONParseResult try_parse(const string &str);
+
+    // 与JSON(str)相同，但每个数字都保留输入中的原文：dump和operator<<原样输出，number_text()返回原文
+    static JSON parse_preserving_numbers(const string &str);
+
+    // 只解析projection中的字段，结果是只含这些字段的对象。其余的值用括号匹配跳过，不构造节点，也不做完整的校验
+    static JSON parse_projected(const string &str, const JSONProjection &projection);
+
+    /* 拷贝控制成员，拷贝是深拷贝，移动只转移子树的所有权。需要廉价拷贝时使用snapshot() */
+    JSON(const JSON &json);
+
+    JSON(JSON &&json) noexcept: JSON() {
+        steal(json);
+    }
+
+    ~JSON() {
+        if (type >= JSON_ARRAY_TYPE || (type == STRING_TYPE && (short_size == LONG_STRING || short_size == SHARED_STRING)) ||
+            short_size == NUMBER_TEXT)
+            release();
+    }
+
+    // 返回与本值共享子树的拷贝，耗时与树的大小无关。之后任何一方通过operator[]、at、push_back、
+    // remove、pop或merge修改时，只复制被修改路径上的容器，其余子树仍然共享。
+    // 取快照之前得到的引用不能再用于修改，否则修改对双方都可见
+    JSON snapshot() const;
+
+    // 通用操作
+    bool empty() const;
+
+    size_t size() const;
+
+    // 序列化为JSON文本，indent小于0时为紧凑格式，否则每层缩进indent个空格
+    string dump(int indent = -1) const;
+
+    // 序列化后追加到调用者提供的缓冲区out末尾，可以复用同一个缓冲区避免重复分配
+    void dump(string &out, int indent = -1) const;
+
+    // 多线程序列化，结果与dump(indent)相同。元素很多的数组和对象被分成若干段，由threads个线程（为0时使用
+    // 硬件线程数）分别格式化后按顺序拼接；没有这样的容器时单线程序列化
+    string dump_parallel(int indent = -1, unsigned threads = 0) const;
+
+    // 同上，各段完成后按顺序写入out，不在内存中拼接出完整的文本
+    void dump_parallel(ostream &out, int indent = -1, unsigned threads = 0) const;
+
+    // 编码为MessagePack。整数使用能容纳它的最短格式，浮点数为float64，保留的数字原文不输出
+    string dump_msgpack() const;
+
+    // 编码后追加到out末尾
+    void dump_msgpack(string &out) const;
+
+    // 编码后写入out，每满64KB写一次
+    void dump_msgpack(ostream &out) const;
+
+    // 解析MessagePack编码的值，顶层可以是任意值。bin按字符串读取，map的键必须是字符串，不支持ext类型
+    static JSON parse_msgpack(const string &data);
+
+    // 从in中读取恰好一个MessagePack值，之后的数据留在流中
+    static JSON parse_msgpack(istream &in);
+
+    // 赋值操作符
+    JSON &operator=(const string &v);
+
+    JSON &operator=(const char v[]);
+
+    JSON &operator=(const long double &v);
+
+    JSON &operator=(const double &v);
+
+    JSON &operator=(const long long &v);
+
+    JSON &operator=(const unsigned long long &v);
+
+    JSON &operator=(const int &v);
+
+    JSON &operator=(const bool &v);
+
+    JSON &operator=(std::nullptr_t v);
+
+    JSON &operator=(const JSON &json);
+
+    JSON &operator=(JSON &&json) noexcept;
+
+    // 类型转换
+    explicit operator string() const;
+
+    explicit operator int() const {
+        if (type != INT_TYPE || is_unsigned()) conversion_error("int");
+        return static_cast<int>(integer_value());
+    }
+
+    explicit operator long long() const {
+        if (type != INT_TYPE || is_unsigned()) conversion_error("long long");
+        return integer_value();
+    }
+
+    // 大于INT64_MAX的整数只能以这种方式读取
+    explicit operator unsigned long long() const {
+        if (type != INT_TYPE || (!is_unsigned() && integer_value() < 0)) conversion_error("unsigned long long");
+        return static_cast<unsigned long long>(integer_value());
+    }
+
+    explicit operator long double() const {
+        if (type != FLOAT_TYPE) conversion_error("long double");
+        return floating_value();
+    }
+
+    explicit operator double() const {
+        if (type != FLOAT_TYPE) conversion_error("double");
+        return floating_value();
+    }
+
+    explicit operator bool() const {
+        if (type != BOOL_TYPE) conversion_error("bool");
+        return bool_value;
+    }
+
+    // 非抛出的类型化读取：值的类型与T一致时返回该值，否则返回std::nullopt。T可以是整数类型（整数超出T的
+    // 范围时同样返回std::nullopt）、浮点类型、bool、std::string_view或string。std::string_view指向节点内部，
+    // 只在节点被修改或销毁之前有效
+    template<typename T>
+    std::optional<T> try_get() const;
+
+    // 由parse_preserving_numbers解析出的数字在输入中的原文，其余的值返回空视图
+    std::string_view number_text() const;
+
+    // 类型检查，只读取节点的类型标记
+    bool isString() const { return type == STRING_TYPE; }
+
+    bool isInteger() const { return type == INT_TYPE; }
+
+    bool isFloat() const { return type == FLOAT_TYPE; }
+
+    bool isBool() const { return type == BOOL_TYPE; }
+
+    bool isNULL() const { return type == NULL_TYPE; }
+
+    bool isJSONObject() const { return type == JSON_OBJECT_TYPE; }
+
+    bool isJSONArray() const { return type == JSON_ARRAY_TYPE; }
+
+    // JSON对象操作。添加键值对后，之前得到的该对象中值的引用仍然有效；删除键值对后，其后的值的引用失效
+    JSON &operator[](const string &);
+
+    JSON &operator[](const char str[]);
+
+    JSON &at(const string &);
+
+    JSON &at(const char str[]);
+
+    // 只读查找，不会复制与快照共享的节点
+    const JSON &at(const string &) const;
+
+    const JSON &at(const char str[]) const;
+
+    // 按JSON Pointer（RFC 6901，如"/contact/phone"）查找值，路径不存在时抛出std::out_of_range。
+    // 同一个路径需要反复使用时，先构造JSONPointer再调用其find
+    const JSON &at_pointer(const string &pointer) const;
+
+    vector<string> keys() const;
+
+    bool remove(const string &str);
 
-    explicit StringValue(const char str[]) : StringValue(string(str)) {}
+    bool remove(const char str[]);
+
+    // 参数为右值时直接转移其子节点，否则拷贝
+    template<typename ...args>
+    JSON &merge(args &&... json_list);
 
-    explicit operator string() const { return value; }
+    // JSON数组操作。添加元素后，之前得到的该数组中元素的引用仍然有效；删除元素后，其后的元素的引用失效
+    JSON &operator[](const int &);
+
+    const JSON &operator[](const int &) const;
+
+    template<typename T>
+    void push_back(const T &);
+
+    void push_back(JSON &&json);
+
+    bool pop(int pos);
 
 private:
-    string value;
-};
+    /* 长字符串的存储，size个字符紧跟在结构体之后 */
+    struct StringData {
+        std::pmr::memory_resource *resource;    // 本存储从中分配
+        size_t size;
+
+        const char *data() const { return reinterpret_cast<const char *>(this + 1); }
+    };
 
-/* JSON布尔值类 */
-class BoolValue : public BaseValue {
-    friend ostream &operator<<(ostream &, const BoolValue &);
+    /* 多个节点共用的长字符串，size个字符紧跟在结构体之后，refs为引用它的节点个数 */
+    struct SharedString {
+        std::atomic<size_t> refs{1};
+        std::pmr::memory_resource *resource;    // 本存储从中分配
+        size_t size;
+
+        const char *data() const { return reinterpret_cast<const char *>(this + 1); }
+    };
+
+    /* 对象的键字典：同一次解析中重复出现的长键只分配一份SharedString，各个对象的键节点共用它。
+     * 短键本来就保存在节点中，不经过字典。表为开放寻址，字典对表中的每个键持有一个引用 */
+    struct KeyDictionary {
+        KeyDictionary() = default;
+
+        KeyDictionary(const KeyDictionary &) = delete;
+
+        KeyDictionary &operator=(const KeyDictionary &) = delete;
+
+        ~KeyDictionary() { clear(); }
+
+        // 释放json原有的值后设为键key，字典中已有从resource中分配的同一个键时共用它
+        void store(JSON &json, std::string_view key, std::pmr::memory_resource *resource);
+
+        void clear() noexcept;
+
+        vector<SharedString *> slots;   // 空槽为nullptr
+        size_t count = 0;
+        // 键各不相同的大对象（例如以ID为键的映射）登记到此数目后不再登记，之后的新键照常单独分配
+        static constexpr size_t MAX_KEYS = 4096;
+    };
+
+    static constexpr unsigned char LONG_STRING = 0xFF;      // short_size的特殊值，表示字符串保存在long_string中
+    static constexpr unsigned char BORROWED_STRING = 0xFE;  // short_size的特殊值，表示字符串借用自borrowed_string
+    static constexpr unsigned char LAZY_CONTAINER = 0xFD;   // short_size的特殊值，表示数组或对象尚未解析
+    static constexpr unsigned char NUMBER_TEXT = 0xFC;      // short_size的特殊值，表示数字的值和原文保存在number_data中
+    static constexpr unsigned char UNSIGNED_INTEGER = 1;    // 整数的short_size为此值时int_value中是大于INT64_MAX的无符号数
+    static constexpr unsigned char SHARED_STRING = 0xFB;    // short_size的特殊值，表示字符串保存在共用的shared_string中
+
+    /* 保留原文的数字：解析出的值和原文一起单独分配，size个字符紧跟在结构体之后 */
+    struct NumberData {
+        std::pmr::memory_resource *resource;    // 本存储从中分配
+        size_t size;
+        long long int_value;    // 与节点中的同名成员含义相同
+        double float_value;
+        bool is_unsigned;
+
+        const char *data() const { return reinterpret_cast<const char *>(this + 1); }
+    };
+
+    // 数字的值，保留原文的数字从number_data中读取
+    long long integer_value() const { return short_size == NUMBER_TEXT ? number_data->int_value : int_value; }
+
+    double floating_value() const { return short_size == NUMBER_TEXT ? number_data->float_value : float_value; }
+
+    bool is_unsigned() const {
+        return short_size == UNSIGNED_INTEGER || (short_size == NUMBER_TEXT && number_data->is_unsigned);
+    }
+
+    // 本节点为数字时把原文text和当前的值一起保存，存储从resource中分配
+    void keep_number_text(std::string_view text, std::pmr::memory_resource *resource);
+
+    void append_number(string &out) const;
+
+    /* 延迟解析的数组和对象所在的文本，由JSONDocument持有。text末尾之后的一个字节为'\0' */
+    struct LazySource {
+        std::string_view text;
+        std::pmr::memory_resource *resource;    // 解析出的存储从中分配
+    };
+    static constexpr size_t SHORT_STRING_CAPACITY = 14;
+
+    struct ParseStack;
+
+    // 解析pos处的值，数组和对象的元素先暂存在stack中，结束时按实际个数一次分配存储
+    static JSON parse(std::string_view str, size_t &pos, std::pmr::memory_resource *resource, ParseStack &stack);
+
+    // 解析完整的JSON文本，顶层必须是对象或数组。borrow_strings为true时不含转义字符的长字符串直接指向str
+    static JSON parse_text(std::string_view str, std::pmr::memory_resource *resource, bool borrow_strings);
+
+    // 校验整个文本后只解析顶层的对象或数组，嵌套的数组和对象记录位置，首次访问时再逐层解析
+    static JSON parse_lazy(const LazySource &source);
+
+    // 按projection的第node个字段解析pos处的值：保留整个值时与parse相同，否则值是对象时只解析其中被选中的键，
+    // 值不是对象时跳过并返回空对象
+    static JSON parse_projected(std::string_view str, size_t &pos, std::pmr::memory_resource *resource,
+                                ParseStack &stack, const JSONProjection &projection, size_t node);
+
+    // 本节点为null时设为延迟解析的数组或对象，其文本从source的offset处开始
+    void defer(unsigned char container_type, const LazySource *source, size_t offset);
+
+    // 延迟解析的数组或对象在首次访问时解析一层，结果保存在本节点中，存储从文档的内存池中分配。
+    // 修改的是缓存而不是值，因此是const函数，但延迟解析的文档不能被多个线程同时读取
+    void materialize() const {
+        if (short_size == LAZY_CONTAINER) parse_deferred();
+    }
 
+    void parse_deferred() const;
+
+    void materialize_tree() const;  // 解析本值中所有尚未解析的数组和对象，之后可以被多个线程同时读取
+
+    static JSON empty_container(unsigned char container_type);  // 空的数组或对象，不分配存储
+
+    [[noreturn]] static void conversion_error(const char *type_name);  // 抛出无法转换为type_name类型的异常
+
+    std::string_view string_value() const;  // 字符串类型的值
+
+    // 释放原有的值后设为字符串value，长字符串从resource中分配
+    void set_string(std::string_view value, std::pmr::memory_resource *resource);
+
+    void borrow_string(std::string_view value);     // 本节点为null时设为指向value的字符串，不拷贝字符
+
+    JSONObject &mutable_object();   // 修改对象前调用：没有存储时分配一份，存储被其他快照共享时先复制一份
+
+    JSONArray &mutable_array();     // 修改数组前调用，规则与mutable_object相同
+
+    void release() noexcept;        // 释放本节点持有的存储，之后本节点为null
+
+    // 本节点为null时接管json的值，json中的字符串、数组和对象变为空，保留原文的数字只留下解析出的值，其余值不变
+    void steal(JSON &json) noexcept {
+        std::memcpy(static_cast<void *>(this), static_cast<const void *>(&json), sizeof(JSON));
+        if (json.short_size == NUMBER_TEXT) {
+            if (json.type == INT_TYPE) {
+                json.short_size = number_data->is_unsigned ? UNSIGNED_INTEGER : 0;
+                json.int_value = number_data->int_value;
+            } else {
+                json.short_size = 0;
+                json.float_value = number_data->float_value;
+            }
+        } else if (json.type == STRING_TYPE || json.type >= JSON_ARRAY_TYPE) {
+            json.short_size = 0;
+        }
+        if (json.type == JSON_ARRAY_TYPE) json.array_data = nullptr;
+        else if (json.type == JSON_OBJECT_TYPE) json.object_data = nullptr;
+    }
+
+    JSON share(std::pmr::memory_resource *resource) const;  // 共享数组和对象的存储，标量直接拷贝，长字符串从resource中分配
+
+    void copy_from(const JSON &json, std::pmr::memory_resource *resource);   // 本节点为null时深拷贝json，存储从resource中分配
+
+    void dump_value(string &out, int indent, int depth) const;     // 序列化本节点，depth为本节点所在的层
+
+    // 序列化第begin到end-1个元素（键值对），包括它们之前的逗号、缩进和键，不包括括号
+    void dump_members(string &out, int indent, int depth, size_t begin, size_t end) const;
+
+    void dump_member_prefix(string &out, int indent, int depth, size_t i) const;
+
+    struct DumpSegment;
+
+    // 把本容器（位于第depth层）的输出拆成固定的文本和每段至多chunk个元素的待格式化的段
+    void plan_dump(int indent, int depth, size_t chunk, vector<DumpSegment> &segments) const;
+
+    // 并行格式化各段，按顺序交给sink，sink可以取走传给它的字符串
+    void dump_segments(int indent, unsigned threads, const std::function<void(string &)> &sink) const;
+
+    // 编码本节点并追加到out，stream不为空时out每满64KB写入stream后清空
+    void pack_msgpack(string &out, ostream *stream) const;
+
+    struct MsgpackReader;
+
+    static JSON unpack_msgpack(MsgpackReader &reader, std::pmr::memory_resource *resource);
+
+    void merge_value(const JSON &json);     // 将JSON对象json的键值对拷贝到本对象
+
+    void merge_value(JSON &&json);          // 将JSON对象json的键值对转移到本对象
+
+    unsigned char type;         // JSON值的类型
+    unsigned char short_size;   // 短字符串的长度，为LONG_STRING时字符串保存在long_string中；数字见NUMBER_TEXT和UNSIGNED_INTEGER
+    char short_string[6];       // 短字符串从这里开始保存，超过6个字节的部分紧接着保存在short_tail中；
+                                // 借用的字符串在后4个字节中保存长度，延迟解析的容器在这里保存文本中的位置
+    union {
+        long long int_value;
+        double float_value;
+        bool bool_value;
+        StringData *long_string;
+        SharedString *shared_string;    // 引用计数由本节点持有一份
+        NumberData *number_data;
+        const char *borrowed_string;    // 不归本节点所有，由JSONDocument保证其有效
+        const LazySource *lazy_source;  // 同上
+        JSONArray *array_data;      // 为空表示空数组
+        JSONObject *object_data;    // 为空表示空对象
+        char short_tail[8];
+    };
+};
+
+/* 数组元素和对象键值对的存储，元素按值分块保存。第一块按assign或首次reserve的个数分配，解析出的容器只有这一块；
+ * 之后每一块的容量不小于已有的总容量，因此块数是对数级的。已有的元素从不移动，追加元素后之前得到的引用仍然有效。
+ * 删除元素时其后的元素依次前移 */
+template<typename T>
+class JSONStableVector {
 public:
-    explicit BoolValue(const bool &v) : BaseValue(BOOL_TYPE), value(v) {}
+    template<typename Value>
+    class Iterator {
+    public:
+        Iterator(Value *owner, size_t index) : owner(owner), index(index) {}
+
+        auto &operator*() const { return (*owner)[index]; }
+
+        auto *operator->() const { return &(*owner)[index]; }
+
+        Iterator &operator++() {
+            ++index;
+            return *this;
+        }
+
+        bool operator==(const Iterator &other) const { return index == other.index; }
+
+        bool operator!=(const Iterator &other) const { return index != other.index; }
+
+    private:
+        Value *owner;
+        size_t index;
+    };
+
+    explicit JSONStableVector(std::pmr::memory_resource *resource) : resource(resource), chunks(resource) {}
+
+    JSONStableVector(const JSONStableVector &) = delete;
+
+    JSONStableVector &operator=(const JSONStableVector &) = delete;
+
+    ~JSONStableVector() {
+        clear();
+        if (first) resource->deallocate(first, first_capacity * sizeof(T), alignof(T));
+        for (const Chunk &chunk: chunks) resource->deallocate(chunk.data, chunk.capacity * sizeof(T), alignof(T));
+    }
+
+    size_t size() const { return count; }
+
+    bool empty() const { return count == 0; }
+
+    T &operator[](size_t i) { return i < first_capacity ? first[i] : locate(i); }
+
+    const T &operator[](size_t i) const { return i < first_capacity ? first[i] : locate(i); }
+
+    T &back() { return (*this)[count - 1]; }
+
+    Iterator<JSONStableVector> begin() { return {this, 0}; }
+
+    Iterator<JSONStableVector> end() { return {this, count}; }
+
+    Iterator<const JSONStableVector> begin() const { return {this, 0}; }
 
-    explicit operator bool() const { return value; }
+    Iterator<const JSONStableVector> end() const { return {this, count}; }
+
+    // 保证容量不小于n，已有的元素不移动
+    void reserve(size_t n) {
+        if (n > capacity) add_chunk(n - capacity);
+    }
+
+    template<typename ...Args>
+    T &emplace_back(Args &&... args) {
+        if (count == capacity) add_chunk(std::max<size_t>(capacity, 4));
+        T *slot = &(*this)[count];
+        new(slot) T(std::forward<Args>(args)...);
+        ++count;
+        return *slot;
+    }
+
+    void push_back(T &&value) { emplace_back(std::move(value)); }
+
+    // 清空后按[begin, end)的元素个数一次预留，再逐个构造
+    template<typename It>
+    void assign(It begin, It end) {
+        clear();
+        reserve(static_cast<size_t>(std::distance(begin, end)));
+        for (; begin != end; ++begin) emplace_back(*begin);
+    }
+
+    void resize(size_t n) {
+        reserve(n);
+        while (count < n) emplace_back();
+        while (count > n) pop_back();
+    }
+
+    void pop_back() { (*this)[--count].~T(); }
+
+    void erase(size_t index) {
+        for (; index + 1 < count; ++index) (*this)[index] = std::move((*this)[index + 1]);
+        pop_back();
+    }
+
+    void clear() {
+        while (count) pop_back();
+    }
 
 private:
-    bool value;
+    struct Chunk {
+        T *data;
+        size_t start;       // 第一个元素的下标
+        size_t capacity;
+    };
+
+    // 第一块之后的元素：块按start递增排列
+    T &locate(size_t i) const {
+        auto chunk = std::upper_bound(chunks.begin(), chunks.end(), i,
+                                      [](size_t index, const Chunk &c) { return index < c.start; }) - 1;
+        return chunk->data[i - chunk->start];
+    }
+
+    void add_chunk(size_t n) {
+        T *data = static_cast<T *>(resource->allocate(n * sizeof(T), alignof(T)));
+        if (!first) {
+            first = data;
+            first_capacity = n;
+        } else {
+            chunks.push_back({data, capacity, n});
+        }
+        capacity += n;
+    }
+
+    std::pmr::memory_resource *resource;
+    T *first = nullptr;
+    size_t first_capacity = 0;
+    size_t count = 0;
+    size_t capacity = 0;
+    std::pmr::vector<Chunk> chunks;     // 第一块之后的各块，只有追加过元素的容器才有
 };
 
-/* JSON NULL值类 */
-class NULLValue : public BaseValue {
-    friend ostream &operator<<(ostream &, const NULLValue &);
+/* JSON数组的存储。存储可以被多个快照共享，refs为共享它的节点的个数 */
+class JSONArray {
+public:
+    explicit JSONArray(std::pmr::memory_resource *resource) : resource(resource), values(resource) {}
+
+    JSONArray(const JSONArray &) = delete;
+
+    JSONArray &operator=(const JSONArray &) = delete;
 
+    std::atomic<size_t> refs{1};
+    std::pmr::memory_resource *resource;    // 本存储、元素的存储和新元素从中分配
+    JSONStableVector<JSON> values;
+};
+
+/* JSON对象的存储，键值对按插入顺序保存。存储可以被多个快照共享，refs为共享它的节点的个数 */
+class JSONObject {
 public:
-    NULLValue() : BaseValue(NULL_TYPE) {}
+    /* 键值对，键保存为字符串类型的JSON值，短键不需要额外分配内存 */
+    struct Member {
+        JSON key;
+        JSON value;
+    };
+
+    explicit JSONObject(std::pmr::memory_resource *resource)
+            : resource(resource), members(resource), key_index(resource) {}
+
+    JSONObject(const JSONObject &) = delete;
+
+    JSONObject &operator=(const JSONObject &) = delete;
+
+    size_t find_key(std::string_view key) const;   // 返回键的下标，不存在时返回键的个数
+
+    size_t find_key(std::string_view key, size_t hash) const;  // 同上，hash为预先算好的std::hash值
+
+    void index_key(size_t i);       // 将第i个键加入哈希索引
+
+    void index_last_key();          // 追加一个键之后更新哈希索引
+
+    void rebuild_index();           // 按当前的键重建哈希索引，键太少时清空索引
+
+    std::atomic<size_t> refs{1};
+    std::pmr::memory_resource *resource;    // 本存储、键、值的存储和新加入的值从中分配
+    JSONStableVector<Member> members;
+    /* 键的哈希索引：开放寻址表，槽中保存键的下标+1，0表示空槽。键的个数达到INDEX_THRESHOLD时建立，
+     * 之后随键的增删更新，因此查找不会修改共享的存储。键的顺序仍由members决定 */
+    std::pmr::vector<uint32_t> key_index;
+    static constexpr size_t INDEX_THRESHOLD = 16;
 };
 
-/* JSON对象类 */
-class JSONObject : public BaseValue {
-    /* 友元函数 */
-    friend ostream &operator<<(ostream &, const JSONObject &);
+/* 只读映射到内存的文件。text()之后的一个字节总是可读且为'\0'，解析器依赖这一点省去越界检查。
+ * 不支持内存映射的平台上退化为把文件读入内存 */
+class JSONMappedFile {
+public:
+    explicit JSONMappedFile(const string &path);
 
-    friend bool JSONisEmpty(const JSON &);
+    ~JSONMappedFile();
 
-    friend size_t JSONSize(const JSON &);
+    JSONMappedFile(const JSONMappedFile &) = delete;
+
+    JSONMappedFile &operator=(const JSONMappedFile &) = delete;
+
+    std::string_view text() const { return {data, size}; }
 
-    friend bool removeElement(JSONObject &json_object, const string &str);
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+    size_t mapped_size = 0;     // 映射区域的长度，为0表示没有映射，内容保存在buffer中
+    string buffer;
+};
 
+/* JSON文档：解析时所有节点、键和字符串都从文档持有的内存池中顺序分配，
+ * 文档析构时整个内存池一次性释放。从文档中拷贝出去的JSON值使用默认的堆内存，与文档的生命周期无关 */
+class JSONDocument {
 public:
-    /* 构造函数 */
-    explicit JSONObject(const string &json_string);
+    explicit JSONDocument(const string &str);
 
-    explicit JSONObject(const char str[]) : JSONObject(string(str)) {}
+    explicit JSONDocument(const char str[]) : JSONDocument(string(str)) {}
 
-    /* 拷贝控制成员 */
-    JSONObject(const JSONObject &cj);
+    // 映射并解析文件。不含转义字符的长字符串直接指向映射的内容而不拷贝，映射随文档一起释放。
+    // lazy为true时与parse_lazy相同，只解析顶层
+    static JSONDocument parse_file(const string &path, bool lazy = false);
 
-    JSONObject &operator=(const JSONObject &);
+    // 延迟解析：校验整个文本，但只解析顶层的对象或数组。嵌套的数组和对象在第一次通过operator[]、at等访问时
+    // 才解析一层，结果缓存在文档中。文档接管str，长字符串同样直接指向其中的内容
+    static JSONDocument parse_lazy(string str);
 
-    vector<string> keys();
+    JSONDocument(const JSONDocument &) = delete;
 
-    JSON &operator[](const string &);
+    JSONDocument &operator=(const JSONDocument &) = delete;
 
-    JSON &at(const string &);
+    JSON &root() { return root_value; }
 
-    JSONObject &merge(const JSONObject &);
+    const JSON &root() const { return root_value; }
 
 private:
-    vector<string> object_key;     // 保存JSON对象的键
-    vector<shared_ptr<JSON>> object_value;  // 保存JSON对象的值
+    // 解析mapped（为空时为text）的内容，长字符串借用原文
+    JSONDocument(std::unique_ptr<JSONMappedFile> mapped, string text, bool lazy);
+
+    // 借用的字符串和延迟解析的容器指向file或text，它们必须后于root_value析构
+    std::unique_ptr<JSONMappedFile> file;
+    string text;
+    std::pmr::monotonic_buffer_resource arena;  // 内存池，必须先于root_value构造、后于其析构
+    JSON::LazySource source;
+    JSON root_value;
 };
 
-/* JSON数组类 */
-class JSONArray : public BaseValue {
-    /* 友元函数 */
-    friend bool JSONisEmpty(const JSON &);
+/* 只读的磁带表示：整个文档按先序排成一列带标记的64位字，字符串集中存放在另一个缓冲区中，文档只有这两块存储。
+ * 数组和对象的起始字记录元素个数和对应的结束字的位置，遍历时跳过整个子树只需一次读取。
+ * 适合解析一次、之后只读的文档；需要修改时用to_json()转换为JSON */
+class JSONTape {
+public:
+    class Cursor;
 
-    friend ostream &operator<<(ostream &, const JSONArray &);
+    // 直接把文本解析为磁带，不构造JSON节点。顶层必须是对象或数组
+    explicit JSONTape(const string &str);
 
-    friend size_t JSONSize(const JSON &);
+    explicit JSONTape(const char str[]) : JSONTape(string(str)) {}
+
+    explicit JSONTape(const JSON &json);
+
+    Cursor root() const;
+
+    JSON to_json() const;
+
+private:
+    struct Builder;
 
-    friend bool popElement(JSONArray &json_array, int pos);
+    // 从index处的值构造JSON，index移到该值之后。对象的长键经keys共用
+    JSON build_json(size_t &index, JSON::KeyDictionary &keys) const;
 
+    vector<uint64_t> words;     // 每个字的高8位是标记，低56位是内容；数字的值保存在标记之后的下一个字中
+    string strings;             // 每个字符串是4字节的长度和其后的字符，字符串字的内容是它在此处的偏移
+};
+
+/* 磁带上某个值的位置，只是一个指针和下标，可以随意拷贝。指向的磁带必须一直有效。
+ * 访问方式与JSON相同：类型不符时转换抛出std::runtime_error，键或下标不存在时抛出std::out_of_range */
+class JSONTape::Cursor {
 public:
-    /* 构造函数 */
-    explicit JSONArray(const string &str);
+    // 是否已经越过容器中的最后一个值（child()和next()在容器结束时返回这样的位置）
+    bool at_end() const { return tag() == ']' || tag() == '}'; }
 
-    explicit JSONArray(const char str[]) : JSONArray(string(str)) {}
+    bool isString() const { return tag() == '"'; }
 
-    /* 拷贝控制成员 */
-    JSONArray(const JSONArray &cj);
+    bool isInteger() const { return tag() == 'l' || tag() == 'u'; }
 
-    JSONArray &operator=(const JSONArray &cj);
+    bool isFloat() const { return tag() == 'd'; }
 
-    JSON &operator[](const int &);
+    bool isBool() const { return tag() == 't' || tag() == 'f'; }
 
-    /* 将一个JSON值添加到JSON数组末尾 */
-    template<typename T>
-    void push_back(const T &);
+    bool isNULL() const { return tag() == 'n'; }
+
+    bool isJSONObject() const { return tag() == '{'; }
+
+    bool isJSONArray() const { return tag() == '['; }
+
+    // 数组的元素个数或对象的键值对个数，直接从起始字中读出
+    size_t size() const;
+
+    // 数组的第一个元素；对象的第一个键，键的next()是对应的值
+    Cursor child() const;
+
+    // 同一容器中的下一个值（或键），嵌套的数组和对象整个跳过
+    Cursor next() const;
+
+    Cursor operator[](size_t index) const;
 
-    void push_back(const string &value);
+    Cursor at(std::string_view key) const;
 
-    void push_back(const char value[]);
+    // 在对象中查找键，不存在时返回std::nullopt
+    std::optional<Cursor> find(std::string_view key) const;
 
-    void push_back(const long double &value);
+    explicit operator long long() const;
 
-    void push_back(const double &value);
+    explicit operator unsigned long long() const;
 
-    void push_back(const long long &value);
+    explicit operator double() const;
 
-    void push_back(const int &value);
+    explicit operator bool() const;
 
-    void push_back(const bool &value);
+    // 指向磁带的字符串缓冲区，与磁带的生命周期相同
+    explicit operator std::string_view() const;
 
-    void push_back(std::nullptr_t value);
+    explicit operator string() const { return string(static_cast<std::string_view>(*this)); }
 
-    void push_back(const JSON &json);
+    JSON to_json() const;
 
 private:
-    vector<shared_ptr<JSON>> array_value;    // 保存JSON数组
+    friend class JSONTape;
+
+    Cursor(const JSONTape *tape, size_t index) : tape(tape), index(index) {}
+
+    unsigned char tag() const { return static_cast<unsigned char>(tape->words[index] >> 56); }
+
+    uint64_t payload() const { return tape->words[index] & ((uint64_t(1) << 56) - 1); }
+
+    const JSONTape *tape;
+    size_t index;
 };
 
-/* 主JSON类 */
-class JSON {
-    friend shared_ptr<JSON> parse_value(const string &, size_t &pos);
+/* 拉取式的记号读取器：调用者按期望的结构依次读取，值直接交给调用者而不构造JSON节点，结构体绑定用它把文本
+ * 直接解析到成员中。输入与JSON(str)同样校验，记号与期望不符时抛出std::runtime_error */
+class JSONReader {
+public:
+    // text在读取期间必须有效
+    explicit JSONReader(const string &text);
 
-    friend ostream &operator<<(ostream &, const JSONObject &);
+    ~JSONReader();
 
-    friend ostream &operator<<(ostream &out, const JSONArray &json_array);
+    JSONReader(const JSONReader &) = delete;
 
-    friend ostream &operator<<(ostream &out, const JSON &json_value);
+    JSONReader &operator=(const JSONReader &) = delete;
 
-    friend istream &operator>>(istream &, JSON &);
+    void start_object();    // 读取'{'
 
-    friend bool JSONisEmpty(const JSON &);
+    // 读取对象的下一个键和其后的冒号，对象结束时读取'}'并返回false。key在下一次读取之前有效
+    bool next_key(std::string_view &key);
 
-    friend size_t JSONSize(const JSON &);
+    void start_array();     // 读取'['
 
-    friend void JSONArray::push_back(const JSON &json);
+    bool next_element();    // 数组中还有元素时返回true，结束时读取']'并返回false
 
-    friend bool operator==(const JSON &, const JSON &);
+    bool read_null();       // 下一个值是null时读取它并返回true，否则不读取
 
-    friend bool operator!=(const JSON &, const JSON &);
+    bool read_bool();
+
+    long long read_int();
+
+    unsigned long long read_uint();
+
+    double read_double();   // 整数也可以读取为浮点数
+
+    std::string_view read_string();     // 有效期与next_key的key相同
+
+    JSON read_json();
+
+    void skip_value();
+
+    void finish();          // 确认之后只剩空白
+
+private:
+    struct State;
+
+    std::string_view text;
+    size_t pos = 0;
+    bool after_open = false;    // 刚读取了'{'或'['，下一个键或元素之前没有逗号
+    std::unique_ptr<State> state;
+};
 
+/* 结构体绑定序列化时使用的格式化函数，输出与dump()相同 */
+class JSONWriter {
 public:
-    /* 构造函数 */
-    explicit JSON(const string &str);
+    static void string_value(string &out, std::string_view value);
 
-    explicit JSON(const char str[]) : JSON(string(str)) {}
+    static void int_value(string &out, long long value);
 
-    // 通用操作
-    bool empty() const;
+    static void uint_value(string &out, unsigned long long value);
 
-    size_t size() const;
+    static void double_value(string &out, double value);
+};
 
-    // 赋值操作符
-    JSON &operator=(const string &v);
+/* 增量（推送式）解析器：调用者分块送入输入，块的大小任意，跨块的字符串、数字和字面量也能正确解析。
+ * 解析结果直接构造在target中，解析器只缓存当前未结束的一个标量记号，不保存已经处理过的输入 */
+class JSONStreamParser {
+public:
+    explicit JSONStreamParser(JSON &target) : target(target) {}
 
-    JSON &operator=(const char v[]);
+    // 送入下一块输入
+    void feed(const char *data, size_t size);
 
-    JSON &operator=(const long double &v);
+    void feed(const string &chunk) { feed(chunk.data(), chunk.size()); }
 
-    JSON &operator=(const double &v);
+    // 顶层的JSON对象（数组）是否已经完整
+    bool done() const { return completed; }
 
-    JSON &operator=(const long long &v);
+    // 输入结束，顶层值不完整时抛出异常
+    void finish();
 
-    JSON &operator=(const int &v);
+private:
+    // 解析栈中每一层容器期待的下一个记号
+    enum State {
+        ARRAY_START, ARRAY_VALUE, ARRAY_NEXT, OBJECT_START, OBJECT_KEY, OBJECT_COLON, OBJECT_VALUE, OBJECT_NEXT
+    };
+
+    // 正在读取的标量记号
+    enum Token {
+        NO_TOKEN, STRING_TOKEN, NUMBER_TOKEN, LITERAL_TOKEN
+    };
+
+    struct Frame {
+        JSON *node;         // 正在构造的容器
+        State state;
+        JSON key;           // 对象中已读取、尚未对应值的键
+    };
+
+    void start_value(char c);
+
+    size_t continue_token(const char *data, size_t size, size_t i);
+
+    void finish_token();
+
+    JSON *attach(JSON &&node);
+
+    JSON &target;
+    vector<Frame> stack;
+    bool completed = false;     // 顶层值是否已经结束
+    Token token = NO_TOKEN;
+    bool token_is_key = false;  // 当前字符串记号是否为对象的键
+    bool token_escaped = false; // 字符串记号的最后一个字符是否为转义用的反斜杠
+    string pending;             // 当前记号已读取的文本
+    JSON::KeyDictionary keys;   // 各个对象中重复出现的长键共用一份存储
+};
 
-    JSON &operator=(const bool &v);
+/* SAX事件处理器：parse_sax每读到一个记号调用一次对应的函数，函数返回false时立即停止解析。
+ * 传给key和string_value的字符串视图只在本次调用期间有效 */
+class JSONHandler {
+public:
+    virtual ~JSONHandler() = default;
 
-    JSON &operator=(std::nullptr_t v);
+    virtual bool start_object() { return true; }
 
-    JSON &operator=(const JSON &json);
+    virtual bool key(std::string_view) { return true; }
 
-    // 类型转换
-    explicit operator string() const;
+    virtual bool end_object() { return true; }
 
-    explicit operator int() const;
+    virtual bool start_array() { return true; }
 
-    explicit operator long long() const;
+    virtual bool end_array() { return true; }
 
-    explicit operator long double() const;
+    virtual bool string_value(std::string_view) { return true; }
 
-    explicit operator double() const;
+    virtual bool int64_value(long long) { return true; }
 
-    explicit operator bool() const;
+    virtual bool double_value(double) { return true; }
 
-    // 类型检查
-    bool isString();
+    // 大于INT64_MAX的整数，默认按浮点数交给double_value
+    virtual bool uint64_value(unsigned long long value) { return double_value(static_cast<double>(value)); }
 
-    bool isInteger();
+    virtual bool bool_value(bool) { return true; }
 
-    bool isFloat();
+    virtual bool null_value() { return true; }
+};
 
-    bool isBool();
+/* try_parse的结果：成功时保存解析出的值，否则保存错误，用法与C++23的std::expected<JSON, JSONParseError>相同 */
+class JSONParseResult {
+public:
+    JSONParseResult(JSON value) : json(std::move(value)) {}
 
-    bool isNULL();
+    JSONParseResult(const JSONParseError &error) : parse_error(error) {}
 
-    bool isJSONObject();
+    bool has_value() const { return parse_error.code == JSONErrorCode::NONE; }
 
-    bool isJSONArray();
+    explicit operator bool() const { return has_value(); }
 
-    // JSON对象操作
-    JSON &operator[](const string &);
+    // 没有值时抛出std::runtime_error，信息与抛出异常的解析函数相同
+    JSON &value() &;
 
-    JSON &operator[](const char str[]);
+    const JSON &value() const &;
 
-    JSON &at(const string &);
+    JSON &&value() &&;
 
-    JSON &at(const char str[]);
+    JSON &operator*() { return json; }
 
-    vector<string> keys();
+    const JSON &operator*() const { return json; }
 
-    bool remove(const string &str);
+    JSON *operator->() { return &json; }
 
-    bool remove(const char str[]);
+    const JSON *operator->() const { return &json; }
 
-    template<typename ...args>
-    JSON &merge(const args &... json_list);
+    // 成功时code为JSONErrorCode::NONE
+    const JSONParseError &error() const { return parse_error; }
 
-    // JSON数组操作
-    JSON &operator[](const int &);
+private:
+    JSON json;
+    JSONParseError parse_error;
+};
 
-    template<typename T>
-    void push_back(const T &);
+/* 编译好的JSON Pointer（RFC 6901）：构造时解析一次路径，之后可以对任意多个JSON值求值。
+ * 查找不分配内存，对象的键使用预先算好的哈希值，路径不存在时返回空指针而不抛出异常 */
+class JSONPointer {
+    friend class JSONProjection;
 
-    bool pop(int pos);
+public:
+    // 解析路径，路径为空表示整个值，否则必须以'/'开头，'~'之后只能是'0'（'~'）或'1'（'/'）。不合法时抛出std::runtime_error
+    explicit JSONPointer(const string &pointer);
 
-    // 使用std::variant来存储不同类型的JSON值
-    using Value = std::variant<
-            JSONObject,
-            JSONArray,
-            IntValue,
-            FloatValue,
-            StringValue,
-            BoolValue,
-            NULLValue
-    >;
+    explicit JSONPointer(const char pointer[]) : JSONPointer(string(pointer)) {}
 
-    explicit JSON(const Value &v) : value(v) {}
+    // 返回root中路径指向的值，不存在时返回nullptr。返回的指针在root被修改或销毁之前有效
+    const JSON *find(const JSON &root) const;
+
+    // 路径中的引用记号的个数
+    size_t size() const { return tokens.size(); }
+
+private:
+    struct Token {
+        string key;         // 还原转义后的键
+        size_t hash;        // key的std::hash值
+        size_t index;       // 用于数组时的下标，不是合法的下标时为NOT_INDEX
+    };
+
+    static constexpr size_t NOT_INDEX = std::numeric_limits<size_t>::max();
+
+    vector<Token> tokens;
+};
+
+/* 解析时的字段投影：由若干JSON Pointer路径组成，解析时只为路径上的键构造节点，其余的值只匹配引号和括号后跳过，
+ * 既不构造节点也不复制字符串。路径中的记号都按对象的键处理，路径经过的值不是对象时该字段被省略 */
+class JSONProjection {
+    friend class JSON;
+
+public:
+    // 路径的语法与JSONPointer相同，空路径表示保留整个值。没有路径或路径不合法时抛出std::runtime_error
+    explicit JSONProjection(const vector<string> &paths);
 
 private:
-    Value value;
+    struct Field {
+        string key;
+        bool whole = false;         // 为true时保留整个值，否则只保留children中的键
+        vector<size_t> children;    // 子字段在fields中的下标
+    };
+
+    static constexpr size_t NOT_FOUND = std::numeric_limits<size_t>::max();
+
+    // 返回第node个字段中名为key的子字段的下标，没有时返回NOT_FOUND
+    size_t find(size_t node, std::string_view key) const;
+
+    vector<Field> fields;   // fields[0]是整个值
 };
 
 // 模板函数实现
 template<typename T>
-void JSONArray::push_back(const T &value) {
-    throw std::runtime_error("Unqualified JSON value");
+void JSON::push_back(const T &v) {
+    if (type != JSON_ARRAY_TYPE) throw std::runtime_error("The object does not have keys() function");
+    if constexpr (std::is_assignable<JSON &, const T &>::value) {
+        JSON json;
+        json = v;
+        push_back(std::move(json));
+    } else {
+        throw std::runtime_error("Unqualified JSON value");
+    }
 }
 
 template<typename T>
-void JSON::push_back(const T &v) {
-    int type = std::visit([](const auto &v) -> int {
-        return v.valueType();
-    }, value);
-    if (type == JSON_ARRAY_TYPE) {
-        std::get<JSONArray>(value).push_back(v);
+std::optional<T> JSON::try_get() const {
+    if constexpr (std::is_same<T, bool>::value) {
+        if (type == BOOL_TYPE) return bool_value;
+    } else if constexpr (std::is_integral<T>::value) {
+        if (type == INT_TYPE) {
+            long long value = integer_value();
+            if (is_unsigned()) {
+                if (static_cast<unsigned long long>(value) <= std::numeric_limits<T>::max())
+                    return static_cast<T>(static_cast<unsigned long long>(value));
+            } else if constexpr (std::is_signed<T>::value) {
+                if (value >= std::numeric_limits<T>::min() && value <= std::numeric_limits<T>::max())
+                    return static_cast<T>(value);
+            } else if (value >= 0 && static_cast<unsigned long long>(value) <= std::numeric_limits<T>::max()) {
+                return static_cast<T>(value);
+            }
+        }
+    } else if constexpr (std::is_floating_point<T>::value) {
+        if (type == FLOAT_TYPE) return static_cast<T>(floating_value());
+    } else if constexpr (std::is_same<T, std::string_view>::value) {
+        if (type == STRING_TYPE) return string_value();
     } else {
-        throw std::runtime_error("The object does not have keys() function");
+        static_assert(std::is_same<T, string>::value, "Unsupported type for JSON::try_get");
+        if (type == STRING_TYPE) return string(string_value());
     }
+    return std::nullopt;
 }
 
 template<typename ...args>
-JSON &JSON::merge(const args &... json_list) {
-    ([json_list, this]() {
-        if (std::is_same<typename std::decay<decltype(json_list)>::type, JSON>::value) {
-            int type = std::visit([](const auto &v) -> int {
-                return v.valueType();
-            }, json_list.value);
-            if (type == JSON_OBJECT_TYPE) {
-                std::get<JSONObject>(this->value).merge(std::get<JSONObject>(json_list.value));
-            } else {
-                throw std::runtime_error("Cannot add JSONArray to the JSON object");
-            }
+JSON &JSON::merge(args &&... json_list) {
+    static_assert((std::is_same<typename std::decay<args>::type, JSON>::value && ...),
+                  "Cannot add this variable to the JSON object");
+    (merge_value(std::forward<args>(json_list)), ...);
+    return *this;
+}
+
+/* 结构体绑定：CPPJSON_BIND(Type, member...)在编译期登记结构体的成员，parse_struct和dump_struct直接在文本和
+ * 结构体之间转换，不构造JSON节点。成员可以是bool、整数、浮点数、string、JSON、std::optional、std::vector
+ * 以及其他登记过的结构体。解析时文本中没有的成员保持原值，未登记的键被跳过 */
+
+// 键的FNV-1a哈希。成员名的哈希在编译期算好，解析时先比较哈希，相同时再比较键
+constexpr uint64_t json_key_hash(std::string_view key) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c: key) hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+    return hash;
+}
+
+template<typename Class, typename Member>
+struct JSONField {
+    std::string_view name;
+    std::string_view prefix;    // 序列化时写在值之前的,"name":，第一个成员不写逗号
+    uint64_t hash;
+    Member Class::*member;
+};
+
+template<typename Class, typename Member>
+constexpr JSONField<Class, Member> make_json_field(std::string_view name, std::string_view prefix,
+                                                   Member Class::*member) {
+    return {name, prefix, json_key_hash(name), member};
+}
+
+// 登记过的类型由CPPJSON_BIND特化，fields是JSONField的std::tuple
+template<typename T>
+struct JSONBinding {};
+
+template<typename T, typename = void>
+struct is_json_bound : std::false_type {};
+
+template<typename T>
+struct is_json_bound<T, std::void_t<decltype(JSONBinding<T>::fields)>> : std::true_type {};
+
+template<typename T>
+struct is_json_optional : std::false_type {};
+
+template<typename T>
+struct is_json_optional<std::optional<T>> : std::true_type {};
+
+template<typename T>
+struct is_json_vector : std::false_type {};
+
+template<typename T, typename Allocator>
+struct is_json_vector<std::vector<T, Allocator>> : std::true_type {};
+
+template<typename T>
+void read_bound_value(JSONReader &reader, T &value);
+
+template<typename T>
+void write_bound_value(string &out, const T &value);
+
+// 把key对应的值读入object的成员，key不是登记过的成员时返回false。展开后是一串与常量比较的分支
+template<typename T, size_t ...I>
+bool read_bound_field(JSONReader &reader, T &object, std::string_view key, std::index_sequence<I...>) {
+    constexpr auto &fields = JSONBinding<T>::fields;
+    uint64_t hash = json_key_hash(key);
+    return ((std::get<I>(fields).hash == hash && std::get<I>(fields).name == key &&
+             (read_bound_value(reader, object.*(std::get<I>(fields).member)), true)) || ...);
+}
+
+template<typename T, size_t ...I>
+void write_bound_fields(string &out, const T &object, std::index_sequence<I...>) {
+    constexpr auto &fields = JSONBinding<T>::fields;
+    out.push_back('{');
+    ((out.append(std::get<I>(fields).prefix.substr(I == 0)),
+      write_bound_value(out, object.*(std::get<I>(fields).member))), ...);
+    out.push_back('}');
+}
+
+template<typename T>
+void read_bound_value(JSONReader &reader, T &value) {
+    if constexpr (std::is_same<T, bool>::value) {
+        value = reader.read_bool();
+    } else if constexpr (std::is_integral<T>::value) {
+        if constexpr (std::is_signed<T>::value) {
+            long long number = reader.read_int();
+            if (number < std::numeric_limits<T>::min() || number > std::numeric_limits<T>::max())
+                throw std::runtime_error("JSON number out of range");
+            value = static_cast<T>(number);
         } else {
-            throw std::runtime_error("Cannot add this variable to the JSON object");
+            unsigned long long number = reader.read_uint();
+            if (number > std::numeric_limits<T>::max()) throw std::runtime_error("JSON number out of range");
+            value = static_cast<T>(number);
         }
-    }(), ...);
-    return *this;
+    } else if constexpr (std::is_floating_point<T>::value) {
+        value = static_cast<T>(reader.read_double());
+    } else if constexpr (std::is_same<T, string>::value) {
+        value.assign(reader.read_string());
+    } else if constexpr (std::is_same<T, JSON>::value) {
+        value = reader.read_json();
+    } else if constexpr (is_json_optional<T>::value) {
+        if (reader.read_null()) value.reset();
+        else read_bound_value(reader, value.emplace());
+    } else if constexpr (is_json_vector<T>::value) {
+        value.clear();
+        reader.start_array();
+        while (reader.next_element()) {
+            if constexpr (std::is_same<typename T::value_type, bool>::value) value.push_back(reader.read_bool());
+            else read_bound_value(reader, value.emplace_back());
+        }
+    } else {
+        static_assert(is_json_bound<T>::value, "Type is not registered with CPPJSON_BIND");
+        using Fields = typename std::remove_const<decltype(JSONBinding<T>::fields)>::type;
+        reader.start_object();
+        std::string_view key;
+        while (reader.next_key(key))
+            if (!read_bound_field(reader, value, key, std::make_index_sequence<std::tuple_size<Fields>::value>()))
+                reader.skip_value();
+    }
 }
 
+template<typename T>
+void write_bound_value(string &out, const T &value) {
+    if constexpr (std::is_same<T, bool>::value) {
+        out += value ? "true" : "false";
+    } else if constexpr (std::is_integral<T>::value) {
+        if constexpr (std::is_signed<T>::value) JSONWriter::int_value(out, value);
+        else JSONWriter::uint_value(out, value);
+    } else if constexpr (std::is_floating_point<T>::value) {
+        JSONWriter::double_value(out, static_cast<double>(value));
+    } else if constexpr (std::is_same<T, string>::value) {
+        JSONWriter::string_value(out, value);
+    } else if constexpr (std::is_same<T, JSON>::value) {
+        value.dump(out);
+    } else if constexpr (is_json_optional<T>::value) {
+        if (value) write_bound_value(out, *value);
+        else out += "null";
+    } else if constexpr (is_json_vector<T>::value) {
+        out.push_back('[');
+        for (size_t i = 0; i < value.size(); ++i) {
+            if (i) out.push_back(',');
+            write_bound_value(out, static_cast<const typename T::value_type &>(value[i]));
+        }
+        out.push_back(']');
+    } else {
+        static_assert(is_json_bound<T>::value, "Type is not registered with CPPJSON_BIND");
+        using Fields = typename std::remove_const<decltype(JSONBinding<T>::fields)>::type;
+        write_bound_fields(out, value, std::make_index_sequence<std::tuple_size<Fields>::value>());
+    }
+}
+
+// 把JSON文本直接解析到value中，顶层的类型由T决定
+template<typename T>
+void parse_struct(const string &str, T &value) {
+    JSONReader reader(str);
+    read_bound_value(reader, value);
+    reader.finish();
+}
+
+template<typename T>
+T parse_struct(const string &str) {
+    T value{};
+    parse_struct(str, value);
+    return value;
+}
+
+// 把value序列化为紧凑格式的JSON文本并追加到out末尾，成员按登记的顺序输出
+template<typename T>
+void dump_struct(const T &value, string &out) {
+    write_bound_value(out, value);
+}
+
+template<typename T>
+string dump_struct(const T &value) {
+    string out;
+    write_bound_value(out, value);
+    return out;
+}
+
+#define CPPJSON_EXPAND(x) x
+#define CPPJSON_CONCAT_(a, b) a##b
+#define CPPJSON_CONCAT(a, b) CPPJSON_CONCAT_(a, b)
+#define CPPJSON_COUNT_N(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, N, ...) N
+#define CPPJSON_COUNT(...) CPPJSON_EXPAND(CPPJSON_COUNT_N(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+#define CPPJSON_FOR_EACH_1(m, t, x) m(t, x)
+#define CPPJSON_FOR_EACH_2(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_1(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_3(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_2(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_4(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_3(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_5(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_4(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_6(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_5(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_7(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_6(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_8(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_7(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_9(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_8(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_10(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_9(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_11(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_10(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_12(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_11(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_13(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_12(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_14(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_13(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_15(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_14(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_16(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_15(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_17(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_16(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_18(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_17(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_19(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_18(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_20(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_19(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_21(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_20(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_22(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_21(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_23(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_22(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_24(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_23(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_25(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_24(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_26(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_25(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_27(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_26(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_28(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_27(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_29(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_28(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_30(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_29(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_31(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_30(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH_32(m, t, x, ...) m(t, x), CPPJSON_EXPAND(CPPJSON_FOR_EACH_31(m, t, __VA_ARGS__))
+#define CPPJSON_FOR_EACH(m, t, ...) \
+    CPPJSON_EXPAND(CPPJSON_CONCAT(CPPJSON_FOR_EACH_, CPPJSON_COUNT(__VA_ARGS__))(m, t, __VA_ARGS__))
+#define CPPJSON_FIELD(Type, name) make_json_field(#name, ",\"" #name "\":", &Type::name)
+
+// 在全局命名空间中登记结构体Type的成员（至多32个），例如CPPJSON_BIND(Point, x, y)
+#define CPPJSON_BIND(Type, ...)                                                                     \
+    template<>                                                                                      \
+    struct JSONBinding<Type> {                                                                      \
+        static constexpr auto fields = std::make_tuple(CPPJSON_FOR_EACH(CPPJSON_FIELD, Type, __VA_ARGS__)); \
+    };
+
 #endif //CPPJSON_CPPJSON_H
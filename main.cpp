@@ -43,14 +43,13 @@ int main() {
     cout << json_object3 << endl;
 
     file.close();
-    file.open(json_array_file);
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open the file " << json_array_file << std::endl;
+    JSON json_array1;
+    try {
+        json_array1 = JSON::parse_file(json_array_file);     // 映射JSON文件并直接解析
+    } catch (const std::runtime_error &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
-    JSON json_array1{"[]"};
-
-    file >> json_array1;     // 解析JSON文件
     istrm.clear();
     istrm.str("-1");
     istrm >> json_array1[0];
@@ -65,6 +64,5 @@ int main() {
     cout << json_array2 << endl;
     cout << "json_array2.size():" << json_array2.size() << endl;
 
-    file.close();
     return 0;
 }
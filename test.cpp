@@ -0,0 +1,922 @@
+#include <iostream>
+#include <cmath>
+#include <functional>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <random>
+#include <cstring>
+#include "cppJSON.h"
+
+using std::cout;
+using std::endl;
+
+/* 结构体绑定测试用的类型 */
+struct TestPoint {
+    int x = 0;
+    int y = 0;
+};
+CPPJSON_BIND(TestPoint, x, y)
+
+struct TestShape {
+    string name = "unnamed";
+    std::vector<TestPoint> points;
+    std::optional<double> weight;
+    unsigned char level = 7;
+    bool visible = true;
+    JSON extra;
+};
+CPPJSON_BIND(TestShape, name, points, weight, level, visible, extra)
+
+/* 把SAX事件记录为文本，limit个事件之后中止解析 */
+class RecordingHandler : public JSONHandler {
+public:
+    explicit RecordingHandler(size_t limit = SIZE_MAX) : limit(limit) {}
+
+    bool start_object() override { return add("{"); }
+
+    bool key(std::string_view k) override { return add("key:" + string(k)); }
+
+    bool end_object() override { return add("}"); }
+
+    bool start_array() override { return add("["); }
+
+    bool end_array() override { return add("]"); }
+
+    bool string_value(std::string_view v) override { return add("str:" + string(v)); }
+
+    bool int64_value(long long v) override { return add("int:" + std::to_string(v)); }
+
+    bool double_value(double v) override { return add("double:" + std::to_string(v)); }
+
+    bool uint64_value(unsigned long long v) override { return add("uint:" + std::to_string(v)); }
+
+    bool bool_value(bool v) override { return add(v ? "true" : "false"); }
+
+    bool null_value() override { return add("null"); }
+
+    string events;
+
+private:
+    bool add(const string &event) {
+        events += event + " ";
+        return --limit > 0;
+    }
+
+    size_t limit;
+};
+
+/* 回归测试：每个检查失败时输出所在的行，最后以失败的个数作为退出码 */
+static int failures = 0;
+
+#define CHECK(condition)                                                            \
+    do {                                                                            \
+        if (!(condition)) {                                                         \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " #condition << endl;    \
+            ++failures;                                                             \
+        }                                                                           \
+    } while (false)
+
+/* 内存池中的文档与普通解析的结果相同，可以修改；拷贝出的值不依赖文档的生命周期 */
+static void test_document() {
+    string text = "{\"name\":\"a string long enough to be stored outside the node\",\"esc\":\"tab\\there\","
+                  "\"list\":[1,2.5,true,null,{\"k\":[\"v\"]}],\"empty\":{}}";
+    JSON copy;
+    {
+        JSONDocument doc(text);
+        CHECK(doc.root() == JSON(text));
+        doc.root()["list"].push_back("added to the arena document, also long");
+        doc.root()["name"] = "short";
+        doc.root().remove("empty");
+        CHECK(doc.root().dump() == "{\"name\":\"short\",\"esc\":\"tab\\there\",\"list\":[1,2.5,true,null,"
+                                   "{\"k\":[\"v\"]},\"added to the arena document, also long\"]}");
+        copy = doc.root()["list"];
+    }
+    CHECK(copy.size() == 6 && copy[5].dump() == "\"added to the arena document, also long\"");
+    JSON parsed(text, std::pmr::new_delete_resource());
+    CHECK(parsed == JSON(text));
+    bool thrown = false;
+    try {
+        JSONDocument bad("{\"a\":}");
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+/* 键很多的对象使用哈希索引查找：添加、删除和拷贝之后查找结果仍然正确，键的顺序不变 */
+static void test_wide_object() {
+    string text = "{";
+    for (int i = 0; i < 200; ++i) text += (i ? ",\"key" : "\"key") + std::to_string(i) + "\":" + std::to_string(i);
+    text += "}";
+    JSON json(text);
+    bool found = true;
+    for (int i = 0; i < 200; ++i) found &= static_cast<int>(json.at("key" + std::to_string(i))) == i;
+    CHECK(found && json.size() == 200);
+    for (int i = 0; i < 200; i += 2) CHECK(json.remove("key" + std::to_string(i)));
+    CHECK(!json.remove("key0") && json.size() == 100);
+    for (int i = 200; i < 260; ++i) json["key" + std::to_string(i)] = i;
+    found = true;
+    for (int i = 1; i < 260; i += 2) found &= i >= 200 || static_cast<int>(json.at("key" + std::to_string(i))) == i;
+    for (int i = 200; i < 260; ++i) found &= static_cast<int>(json.at("key" + std::to_string(i))) == i;
+    CHECK(found && json.size() == 160);
+    CHECK(json.keys().front() == "key1" && json.keys().back() == "key259");
+    bool missing = false;
+    try {
+        static_cast<const JSON &>(json).at("key0");
+    } catch (const std::exception &) {
+        missing = true;
+    }
+    CHECK(missing);
+    JSON copy = json, snapshot = json.snapshot();
+    copy["key1"] = -1;
+    CHECK(static_cast<int>(copy.at("key1")) == -1 && static_cast<int>(snapshot.at("key1")) == 1 && copy.size() == 160);
+    CHECK(JSONEqual(json, snapshot) && json != copy);
+}
+
+/* 按块扫描字符串和空白：引号、转义字符和空白的结尾落在块内任何位置时结果都相同 */
+static void test_block_scanning() {
+    for (size_t length = 0; length < 70; ++length) {
+        string plain(length, 'a');
+        JSON json("[\"" + plain + "\"]");
+        CHECK(json[0].try_get<string>() == plain);
+        for (size_t at = 0; at <= length; ++at) {
+            string escaped = "[\"" + plain.substr(0, at) + "\\\"" + plain.substr(at) + "\"]";
+            CHECK(JSON(escaped)[0].try_get<string>() == plain.substr(0, at) + "\"" + plain.substr(at));
+        }
+        string spaced = "[" + string(length, ' ') + "1" + string(length, '\n') + "," + string(length, '\t') + "2" +
+                        string(length, '\r') + "]";
+        CHECK(JSON(spaced).dump() == "[1,2]");
+        CHECK(JSON("{" + string(length, ' ') + "\"k\"" + string(length, ' ') + ":" + string(length, ' ') + "\"" +
+                   string(length, '\\') + string(length, '\\') + "\"}")["k"].try_get<string>() == string(length, '\\'));
+    }
+    string multibyte;
+    for (int i = 0; i < 40; ++i) multibyte += "\xE4\xB8\xAD";
+    CHECK(JSON("[\"" + multibyte + "\"]")[0].try_get<string>() == multibyte);
+}
+
+/* SAX解析按文本的顺序产生事件，处理函数返回false时立即中止 */
+static void test_sax() {
+    string text = "{\"a\":[1,-2,2.5,18446744073709551615,\"s\\n\",true,false,null],\"b\":{},\"c\":[]}";
+    RecordingHandler handler;
+    CHECK(parse_sax(text, handler));
+    CHECK(handler.events == "{ key:a [ int:1 int:-2 double:2.500000 uint:18446744073709551615 str:s\n true false null ] "
+                            "key:b { } key:c [ ] } ");
+    RecordingHandler stopped(4);
+    CHECK(!parse_sax(text, stopped) && stopped.events == "{ key:a [ int:1 ");
+    JSONHandler ignore;
+    CHECK(parse_sax("[18446744073709551615]", ignore));
+    for (const char *bad: {"{\"a\":}", "[1,]", "[1] 2", "{\"a\" 1}", "[\"abc]"}) {
+        bool thrown = false;
+        try {
+            parse_sax(bad, ignore);
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+}
+
+/* dump的紧凑和缩进格式、字符串转义、追加到已有的缓冲区，以及浮点数往返不丢失精度 */
+static void test_dump() {
+    JSON json("{\"a\":[1,{\"b\":null},[]],\"c\":{},\"s\":\"q\\\"\\\\\\u0001\\t\",\"f\":0.1,\"i\":3.0}");
+    string compact = "{\"a\":[1,{\"b\":null},[]],\"c\":{},\"s\":\"q\\\"\\\\\\u0001\\t\",\"f\":0.1,\"i\":3.0}";
+    CHECK(json.dump() == compact);
+    CHECK(json.dump(2) == "{\n  \"a\": [\n    1,\n    {\n      \"b\": null\n    },\n    []\n  ],\n  \"c\": {},\n"
+                          "  \"s\": \"q\\\"\\\\\\u0001\\t\",\n  \"f\": 0.1,\n  \"i\": 3.0\n}");
+    CHECK(JSON(json.dump(4)) == json && JSON(json.dump(0)) == json);
+    string buffer = "prefix:";
+    json["c"].dump(buffer);
+    json["a"].dump(buffer, 1);
+    CHECK(buffer == "prefix:{}[\n 1,\n {\n  \"b\": null\n },\n []\n]");
+
+    std::mt19937_64 random(7);
+    bool exact = true;
+    JSON values = JSON("[]");
+    for (int i = 0; i < 2000; ++i) {
+        double value;
+        uint64_t bits = random();
+        std::memcpy(&value, &bits, sizeof value);
+        if (!std::isfinite(value)) continue;
+        values.push_back(value);
+    }
+    JSON parsed(values.dump());
+    for (size_t i = 0; i < values.size(); ++i) {
+        double a = static_cast<double>(values[static_cast<int>(i)]), b = static_cast<double>(parsed[static_cast<int>(i)]);
+        exact &= std::memcmp(&a, &b, sizeof a) == 0;
+    }
+    CHECK(exact && parsed.size() == values.size());
+}
+
+/* 延迟解析的文档中嵌套的容器在并行序列化之前已全部解析，结果与单线程序列化相同 */
+static void test_dump_parallel_lazy() {
+    string text = "{\"meta\":{\"n\":1},\"records\":[";
+    for (int i = 0; i < 20000; ++i) {
+        if (i) text += ",";
+        text += "{\"id\":" + std::to_string(i) + ",\"tags\":[\"a\",{\"b\":[" + std::to_string(i % 7) + "]}]}";
+    }
+    text += "]}";
+    string expected = JSON(text).dump();
+    JSONDocument doc = JSONDocument::parse_lazy(text);
+    CHECK(doc.root().dump_parallel(-1, 4) == expected);
+    JSONDocument indented = JSONDocument::parse_lazy(text);
+    CHECK(indented.root().dump_parallel(2, 4) == JSON(text).dump(2));
+}
+
+/* 移动只转移子树：被移走的值保留类型但为空，自我移动赋值不改变值 */
+static void test_move_semantics() {
+    string text = "{\"k\":[1,2],\"s\":\"a long string value that is stored separately\"}";
+    JSON a(text);
+    JSON b(std::move(a));
+    CHECK(a.isJSONObject() && a.size() == 0 && b == JSON(text));
+    JSON c;
+    c = std::move(b["s"]);
+    CHECK(b["s"].isString() && b["s"].try_get<string>() == "");
+    CHECK(c.try_get<string>() == "a long string value that is stored separately");
+    JSON array("[]"), inner("[1,2,3]");
+    array.push_back(std::move(inner));
+    CHECK(inner.isJSONArray() && inner.size() == 0 && array.dump() == "[[1,2,3]]");
+    JSON merged("{\"x\":1}"), other("{\"y\":[5]}");
+    merged.merge(std::move(other), JSON("{\"z\":null}"));
+    CHECK(merged.dump() == "{\"x\":1,\"y\":[5],\"z\":null}" && other.size() == 0);
+    JSON &self = c;
+    c = std::move(self);
+    CHECK(c.try_get<string>() == "a long string value that is stored separately");
+    vector<JSON> values;
+    for (int i = 0; i < 100; ++i) values.push_back(JSON("{\"i\":[" + std::to_string(i) + "]}"));
+    CHECK(static_cast<int>(values[99]["i"][0]) == 99);
+}
+
+/* 类型检查、类型转换和try_get：类型不符或超出目标类型的范围时转换抛出异常，try_get返回std::nullopt */
+static void test_accessors() {
+    JSON json("[300,-5,2.5,true,null,\"short\",\"a string longer than the inline buffer\",[1],{\"k\":1},"
+              "18446744073709551615]");
+    CHECK(json[0].isInteger() && json[2].isFloat() && json[3].isBool() && json[4].isNULL() && json[5].isString());
+    CHECK(json[7].isJSONArray() && json[8].isJSONObject() && json[9].isInteger());
+    CHECK(static_cast<int>(json[0]) == 300 && static_cast<long long>(json[1]) == -5 && static_cast<double>(json[2]) == 2.5);
+    CHECK(static_cast<bool>(json[3]) && static_cast<string>(json[6]) == "a string longer than the inline buffer");
+    CHECK(json[0].try_get<int>() == 300 && !json[0].try_get<signed char>() && json[0].try_get<uint16_t>() == 300);
+    CHECK(!json[1].try_get<unsigned>() && json[1].try_get<int8_t>() == -5);
+    CHECK(json[2].try_get<double>() == 2.5 && !json[2].try_get<int>() && !json[0].try_get<double>());
+    CHECK(json[3].try_get<bool>() == true && !json[4].try_get<bool>());
+    CHECK(json[5].try_get<std::string_view>() == "short" && json[6].try_get<string>() == static_cast<string>(json[6]));
+    CHECK(json[9].try_get<uint64_t>() == UINT64_MAX && !json[9].try_get<int64_t>() && !json[7].try_get<int>());
+    CHECK(JSONSize(json) == 10 && JSONSize(json[8]) == 1 && JSONisEmpty(JSON("{}")) && !JSONisEmpty(json));
+    auto throws = [](const std::function<void()> &convert) {
+        try {
+            convert();
+        } catch (const std::runtime_error &) {
+            return true;
+        }
+        return false;
+    };
+    CHECK(throws([&]() { (void)static_cast<int>(json[2]); }) && throws([&]() { (void)static_cast<double>(json[0]); }));
+    CHECK(throws([&]() { (void)static_cast<bool>(json[4]); }) && throws([&]() { (void)static_cast<string>(json[0]); }));
+    CHECK(throws([&]() { (void)static_cast<unsigned long long>(json[1]); }));
+    CHECK(throws([&]() { (void)static_cast<long long>(json[9]); }));
+}
+
+/* 映射文件解析：结果与解析字符串相同，文件长度恰好是页的整数倍时也不越界 */
+static void test_parse_file() {
+    string path = (std::filesystem::temp_directory_path() / "cppjson_test_file.json").string();
+    auto write = [&path](const string &content) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << content;
+    };
+    for (size_t size: {4096, 8192, 100000}) {
+        string text = "[\"" + string(size - 8, 'x') + "\",123]";
+        CHECK(text.size() == size);
+        write(text);
+        CHECK(JSON::parse_file(path) == JSON(text));
+        CHECK(JSONDocument::parse_file(path).root() == JSON(text));
+        CHECK(JSONDocument::parse_file(path, true).root().dump() == text);
+    }
+    write("{\"id\":1}\n{\"id\":2}\n");
+    size_t sum = 0;
+    CHECK(parse_ndjson_file(path, [&](vector<JSON> &batch) {
+        for (JSON &record: batch) sum += static_cast<size_t>(static_cast<long long>(record["id"]));
+    }) == 2 && sum == 3);
+    write("[1,2");
+    auto throws = [](const std::function<void()> &parse) {
+        try {
+            parse();
+        } catch (const std::runtime_error &) {
+            return true;
+        }
+        return false;
+    };
+    CHECK(throws([&]() { JSON::parse_file(path); }));
+    write("");
+    CHECK(throws([&]() { JSON::parse_file(path); }));
+    std::filesystem::remove(path);
+    CHECK(throws([&]() { JSON::parse_file(path); }) && throws([&]() { JSONDocument::parse_file(path); }));
+}
+
+/* 延迟解析：整个文本在一开始就校验，嵌套的容器在访问时才解析，结果与完整解析相同 */
+static void test_lazy_document() {
+    string text = "{\"meta\":{\"name\":\"a long name stored in the source text\",\"tags\":[\"x\",\"y\"]},"
+                  "\"rows\":[[1,2],[3,{\"deep\":[4]}]],\"n\":5}";
+    JSON expected(text);
+    {
+        JSONDocument doc = JSONDocument::parse_lazy(text);
+        CHECK(doc.root().dump() == text && doc.root() == expected);
+    }
+    {
+        JSONDocument doc = JSONDocument::parse_lazy(text);
+        const JSON &root = doc.root();
+        CHECK(root.size() == 3 && static_cast<int>(root.at("n")) == 5);
+        CHECK(static_cast<int>(root.at("rows")[1].at_pointer("/1/deep/0")) == 4);
+        CHECK(root.at("meta").at("name").try_get<string>() == "a long name stored in the source text");
+        doc.root()["meta"]["tags"].push_back("z");
+        doc.root()["rows"].pop(0);
+        CHECK(doc.root().dump() == "{\"meta\":{\"name\":\"a long name stored in the source text\","
+                                   "\"tags\":[\"x\",\"y\",\"z\"]},\"rows\":[[3,{\"deep\":[4]}]],\"n\":5}");
+        JSON copy = doc.root()["rows"], snapshot = doc.root().snapshot();
+        CHECK(copy.dump() == "[[3,{\"deep\":[4]}]]" && snapshot == doc.root());
+    }
+    for (const char *bad: {"{\"a\":[1,2}", "{\"a\":{\"b\":tru}}", "[[\"x]]", "[[1]] x"}) {
+        bool thrown = false;
+        try {
+            JSONDocument::parse_lazy(bad);
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+}
+
+/* 移走保留原文的数字之后，原节点仍是解析出的值 */
+static void test_move_number_text() {
+    JSON p = JSON::parse_preserving_numbers("[1.50, 18446744073709551615, -7, 2e3]");
+    JSON a = std::move(p[0]);
+    CHECK(a.number_text() == "1.50" && static_cast<double>(a) == 1.5);
+    CHECK(p[0].isFloat() && static_cast<double>(p[0]) == 1.5 && p[0].number_text().empty());
+    JSON b = std::move(p[1]);
+    CHECK(b.dump() == "18446744073709551615");
+    CHECK(static_cast<unsigned long long>(p[1]) == 18446744073709551615ULL);
+    JSON c;
+    c = std::move(p[2]);
+    CHECK(c.dump() == "-7" && static_cast<long long>(p[2]) == -7);
+    CHECK(p.dump() == "[1.5,18446744073709551615,-7,2e3]");
+}
+
+/* 下溢的数字是合法的输入，得到0或非规格化数；上溢仍然报错 */
+static void test_number_underflow() {
+    JSON json("[1e-400, -1e-400, 4.9e-324]");
+    CHECK(static_cast<double>(json[0]) == 0.0 && static_cast<double>(json[1]) == 0.0);
+    CHECK(std::signbit(static_cast<double>(json[1])));
+    CHECK(static_cast<double>(json[2]) > 0.0);
+    CHECK(JSON::try_parse("[1e-400]") && JSON::try_parse("{\"a\":-1e-400}"));
+    auto overflow = JSON::try_parse("[1e400]");
+    CHECK(!overflow && overflow.error().code == JSONErrorCode::NUMBER_OUT_OF_RANGE);
+    auto negative = JSON::try_parse("[-1e400]");
+    CHECK(!negative && negative.error().code == JSONErrorCode::NUMBER_OUT_OF_RANGE);
+}
+
+/* 不符合数字语法的输入在任何解析方式下都报错，而不是只转换能识别的前缀 */
+static void test_malformed_numbers() {
+    for (const char *text: {"[1e]", "[1.]", "[01]", "[+1]", "[-]", "[1e+]", "[-01.5]"}) {
+        auto result = JSON::try_parse(text);
+        CHECK(!result && result.error().code == JSONErrorCode::INVALID_NUMBER && result.error().offset == 1);
+        bool thrown = false;
+        try {
+            JSON json(text);
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+    auto dot = JSON::try_parse("[.5]");
+    CHECK(!dot && dot.error().code == JSONErrorCode::INVALID_VALUE);
+    JSON json("[0, -0, 10, 1.5e+3, 2E-2, -0.25]");
+    CHECK(json.dump() == "[0,0,10,1500.0,0.02,-0.25]");
+}
+
+/* 严格解析的错误种类和字节偏移：错误的字节出现在字符串中的任何位置（包括向量化校验的块边界）都能准确定位 */
+static void test_try_parse_errors() {
+    auto error_at = [](const string &text, JSONErrorCode code, size_t offset) {
+        auto result = JSON::try_parse(text);
+        return !result && result.error().code == code && result.error().offset == offset;
+    };
+    const string valid[] = {"a", "\xC3\xA9", "\xE4\xB8\xAD", "\xF0\x9F\x98\x80", "\xEF\xBF\xBF", "\xF4\x8F\xBF\xBF"};
+    const string invalid[] = {"\x80", "\xC0\xAF", "\xC3", "\xE0\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80",
+                              "\xF5\x80\x80\x80", "\xFF", "\xE4\xB8", "\xF0\x9F\x98", "\xC3\xA9\xA9"};
+    for (size_t length: {0, 5, 15, 16, 17, 31, 32, 33, 63, 64, 70}) {
+        for (size_t at = 0; at <= length; ++at) {
+            string prefix = "[\"" + string(at, 'x'), suffix = string(length - at, 'y') + "\"]";
+            for (const string &bytes: valid) {
+                CHECK(JSON::try_parse(prefix + bytes + suffix));
+                CHECK(JSON::try_parse(prefix + bytes + suffix + string(64, ' ')));
+            }
+            for (const string &bytes: invalid) {
+                // 多余的后续字节在合法的字符之后才报错
+                size_t offset = prefix.size() + (bytes == "\xC3\xA9\xA9" ? 2 : 0);
+                CHECK(error_at(prefix + bytes + suffix, JSONErrorCode::INVALID_UTF8, offset));
+                CHECK(error_at(prefix + bytes + suffix + string(64, ' '), JSONErrorCode::INVALID_UTF8, offset));
+                CHECK(error_at("\"" + string(at, 'x') + bytes + string(length - at, 'y') + "\"",
+                               JSONErrorCode::INVALID_UTF8, offset - 1));
+            }
+            CHECK(error_at(prefix + "\x01" + suffix + string(64, ' '), JSONErrorCode::CONTROL_CHARACTER, prefix.size()));
+            CHECK(error_at(prefix + "\xE4\xB8\xAD\n" + suffix, JSONErrorCode::CONTROL_CHARACTER, prefix.size() + 3));
+        }
+    }
+    string chinese;
+    for (int i = 0; i < 30; ++i) chinese += "\xE4\xB8\xAD";
+    CHECK(JSON::try_parse("{\"" + chinese + "\":\"" + chinese + "\\n" + chinese + "\"}"));
+    CHECK(error_at("[\"" + chinese + "\\n" + chinese.substr(1) + "\"]", JSONErrorCode::INVALID_UTF8, 2 + 90 + 2));
+    CHECK(error_at("[\"\\ud83d\"]", JSONErrorCode::INVALID_UNICODE_ESCAPE, 2));
+    CHECK(error_at("[\"\\ude00\"]", JSONErrorCode::INVALID_UNICODE_ESCAPE, 2));
+    CHECK(JSON::try_parse("[\"\\ud83d\\ude00\"]"));
+    CHECK(error_at("[1 2]", JSONErrorCode::EXPECTED_ARRAY_SEPARATOR, 3));
+    CHECK(error_at("{\"a\" 1}", JSONErrorCode::EXPECTED_COLON, 5));
+    CHECK(error_at("[1] x", JSONErrorCode::TRAILING_CHARACTERS, 4));
+    CHECK(error_at("[tru]", JSONErrorCode::INVALID_VALUE, 1));
+    CHECK(error_at("[\"abc", JSONErrorCode::UNTERMINATED_STRING, 1));
+}
+
+/* 忽略键的顺序比较对象时，重复的键一一配对，比较结果与参数的顺序无关 */
+static void test_equal_duplicate_keys() {
+    JSON duplicated("{\"a\":1}"), other("{\"a\":1,\"b\":2}");
+    duplicated.merge(JSON("{\"a\":1}"));
+    CHECK(duplicated.size() == 2);
+    CHECK(!JSONEqual(duplicated, other, true) && !JSONEqual(other, duplicated, true));
+    JSON left("{\"a\":1,\"b\":2}"), right("{\"b\":2,\"a\":2}");
+    left.merge(JSON("{\"a\":2}"));
+    right.merge(JSON("{\"a\":1}"));
+    CHECK(JSONEqual(left, right, true) && JSONEqual(right, left, true));
+    CHECK(!JSONEqual(left, right) && !(left == right));
+    CHECK(JSONEqual(JSON("{\"x\":{\"p\":1,\"q\":2},\"y\":3}"), JSON("{\"y\":3,\"x\":{\"q\":2,\"p\":1}}"), true));
+    CHECK(!JSONEqual(JSON("{\"x\":1,\"y\":3}"), JSON("{\"y\":3,\"z\":1}"), true));
+}
+
+/* 任何解析方式下嵌套过深的输入都报错，而不是耗尽调用栈 */
+static void test_nesting_limit() {
+    auto nested = [](size_t depth) { return string(depth, '[') + string(depth, ']'); };
+    auto throws = [](const std::function<void()> &parse) {
+        try {
+            parse();
+        } catch (const std::runtime_error &e) {
+            return string(e.what()).find("JSON nesting is too deep") != string::npos;
+        }
+        return false;
+    };
+    string deep = nested(100000);
+    CHECK(throws([&]() { JSON json(deep); }));
+    CHECK(throws([&]() { JSONDocument doc(deep); }));
+    CHECK(throws([&]() { JSONDocument::parse_lazy(deep); }));
+    CHECK(throws([&]() { JSONTape tape(deep); }));
+    CHECK(throws([&]() { JSONHandler handler; parse_sax(deep, handler); }));
+    CHECK(throws([&]() { parse_ndjson("[1]\n" + deep + "\n", [](vector<JSON> &) {}); }));
+    CHECK(throws([&]() {
+        JSON json;
+        JSONStreamParser parser(json);
+        parser.feed(deep);
+    }));
+    auto result = JSON::try_parse(deep);
+    CHECK(!result && result.error().code == JSONErrorCode::TOO_DEEP);
+    CHECK(JSON(nested(1024)).dump() == nested(1024));
+    CHECK(throws([&]() { JSON json(nested(1025)); }));
+    // 并行解析时顶层数组本身也算一层：元素嵌套1023层时总共1024层，正好在上限之内
+    auto parallel = [&](size_t element_depth) {
+        string text = "[";
+        for (int i = 0; i < 200000; ++i) text += "[1,2],";
+        return text + nested(element_depth) + "]";
+    };
+    string limit = parallel(1023);
+    CHECK(JSON::parse_parallel(limit, 4) == JSON(limit));
+    CHECK(throws([&]() { JSON::parse_parallel(parallel(1024), 4); }));
+    CHECK(throws([&]() { JSON json(parallel(1024)); }));
+}
+
+/* 结构体绑定：缺少的字段保留原值，多余的字段被跳过，类型或范围不符时报错，序列化与dump()的格式相同 */
+static void test_struct_binding() {
+    TestShape shape = parse_struct<TestShape>(
+            "{\"unknown\":{\"deep\":[1,{\"x\":2}]},\"points\":[{\"x\":1,\"y\":2,\"z\":9},{\"y\":4}],"
+            "\"weight\":2.5,\"extra\":{\"any\":[true]},\"more\":\"ignored\"}");
+    CHECK(shape.name == "unnamed" && shape.level == 7 && shape.visible);
+    CHECK(shape.points.size() == 2 && shape.points[0].x == 1 && shape.points[0].y == 2);
+    CHECK(shape.points[1].x == 0 && shape.points[1].y == 4);
+    CHECK(shape.weight && *shape.weight == 2.5 && shape.extra.dump() == "{\"any\":[true]}");
+
+    parse_struct("{\"weight\":null,\"name\":\"line\",\"level\":255}", shape);
+    CHECK(!shape.weight && shape.name == "line" && shape.level == 255 && shape.points.size() == 2);
+    string text = dump_struct(shape);
+    CHECK(text == "{\"name\":\"line\",\"points\":[{\"x\":1,\"y\":2},{\"x\":0,\"y\":4}],\"weight\":null,"
+                  "\"level\":255,\"visible\":true,\"extra\":{\"any\":[true]}}");
+    CHECK(JSON(text).dump() == text);
+    TestShape round = parse_struct<TestShape>(text);
+    CHECK(dump_struct(round) == text);
+
+    auto rejects = [](const string &input) {
+        try {
+            parse_struct<TestShape>(input);
+        } catch (const std::runtime_error &) {
+            return true;
+        }
+        return false;
+    };
+    CHECK(rejects("{\"level\":256}") && rejects("{\"level\":-1}") && rejects("{\"name\":1}"));
+    CHECK(rejects("{\"points\":{}}") && rejects("{\"points\":[{\"x\":1.5}]}") && rejects("{\"visible\":\"yes\"}"));
+    CHECK(rejects("{\"name\":\"a\"") && rejects("[]") && rejects("{\"unknown\":[1,}"));
+}
+
+/* 并行解析与单线程解析的结果相同，任何一段中的错误都会抛出 */
+static void test_parse_parallel() {
+    string text = " [ ";
+    for (int i = 0; text.size() < (3 << 20); ++i) {
+        if (i) text += i % 3 ? "," : " ,\n ";
+        switch (i % 5) {
+            case 0: text += std::to_string(i); break;
+            case 1: text += "\"string with ] and , and \\\" inside " + std::to_string(i) + "\""; break;
+            case 2: text += "{\"k\":[" + std::to_string(i) + ",{\"x\":null}],\"s\":\"}\"}"; break;
+            case 3: text += "[[],{},true,false,-1.5e3]"; break;
+            default: text += "null";
+        }
+    }
+    text += " ] ";
+    JSON expected(text);
+    for (unsigned threads: {2u, 3u, 8u}) CHECK(JSON::parse_parallel(text, threads) == expected);
+    CHECK(JSON::parse_parallel("[]", 4).dump() == "[]" && JSON::parse_parallel("{\"a\":[1]}", 4).dump() == "{\"a\":[1]}");
+
+    auto throws = [](const string &input) {
+        try {
+            JSON::parse_parallel(input, 4);
+        } catch (const std::runtime_error &) {
+            return true;
+        }
+        return false;
+    };
+    string broken = text;
+    broken.replace(broken.find("null", broken.size() / 2), 4, "nul ");
+    CHECK(throws(broken));
+    CHECK(throws(text.substr(0, text.size() - 3)));
+    CHECK(throws(text + "x"));
+    string bad_last = text;
+    bad_last.replace(bad_last.rfind(']'), 1, ",tru]");
+    CHECK(throws(bad_last));
+}
+
+/* 键字典：重复出现的长键由多个对象共用一份存储，修改、删除或拷贝某个对象不影响其他对象 */
+static void test_shared_keys() {
+    const string name_key = "a_rather_long_key_name", text_key = "another_long_key_\u00e9";
+    string text = "[";
+    for (int i = 0; i < 50; ++i) {
+        text += i ? "," : "";
+        text += "{\"id\":" + std::to_string(i) + ",\"" + name_key + "\":\"v" + std::to_string(i) + "\",\"" + text_key +
+                "\":[" + std::to_string(i) + "]}";
+    }
+    text += "]";
+    const string decoded_key = "another_long_key_\xC3\xA9";
+    JSON json(text);
+    CHECK(json.size() == 50 && json[49][name_key].dump() == "\"v49\"" && static_cast<long long>(json[7][decoded_key][0]) == 7);
+    CHECK((json[3].keys() == vector<string>{"id", name_key, decoded_key}));
+    CHECK(json.dump() == JSON(json.dump()).dump());
+
+    JSON copy = json;
+    JSON snapshot = json.snapshot();
+    json[0][name_key] = "changed";
+    CHECK(json[0].remove(decoded_key) && json[0].size() == 2);
+    json[1][name_key + "_extended"] = 1;
+    CHECK(json[2].dump() == "{\"id\":2,\"" + name_key + "\":\"v2\",\"" + decoded_key + "\":[2]}");
+    CHECK(copy[0][name_key].dump() == "\"v0\"" && copy[0].size() == 3 && copy == snapshot);
+    CHECK(copy[1].size() == 3 && json[1].size() == 4);
+
+    // 取出其中一个对象后释放整个数组，取出的对象的键仍然有效
+    JSON kept = std::move(copy[5]);
+    copy = JSON();
+    snapshot = JSON();
+    CHECK(kept.dump() == "{\"id\":5,\"" + name_key + "\":\"v5\",\"" + decoded_key + "\":[5]}");
+
+    // 其他构造方式的结果与JSON(str)相同
+    JSON expected(text);
+    CHECK(JSONDocument(text).root() == expected);
+    CHECK(JSON::parse_parallel(text, 4) == expected);
+    CHECK(JSON::parse_msgpack(expected.dump_msgpack()) == expected);
+    CHECK(JSONTape(text).to_json() == expected && JSONTape(expected).to_json() == expected);
+    for (size_t chunk: {size_t(1), size_t(7), text.size()}) {
+        JSON streamed;
+        JSONStreamParser parser(streamed);
+        for (size_t i = 0; i < text.size(); i += chunk) parser.feed(text.substr(i, chunk));
+        parser.finish();
+        CHECK(parser.done() && streamed == expected);
+    }
+
+    // 超过字典容量的各不相同的长键照常单独保存
+    JSON wide("{}");
+    for (int i = 0; i < 5000; ++i) wide["distinct_long_key_number_" + std::to_string(i)] = i;
+    JSON reparsed(wide.dump());
+    CHECK(reparsed.size() == 5000 && reparsed == wide && static_cast<long long>(reparsed["distinct_long_key_number_4999"]) == 4999);
+
+    // NDJSON的字典跨批次保留，callback取走的记录在解析结束后仍然有效
+    string lines;
+    for (int i = 0; i < 40000; ++i)
+        lines += "{\"" + name_key + "\":" + std::to_string(i) + ",\"" + decoded_key + "\":\"" + name_key + "\"}\n";
+    vector<JSON> records;
+    parse_ndjson(lines, [&records](vector<JSON> &batch) {
+        for (JSON &record: batch) records.push_back(std::move(record));
+    }, 4);
+    bool intact = records.size() == 40000;
+    for (size_t i = 0; intact && i < records.size(); ++i)
+        intact = static_cast<size_t>(static_cast<long long>(records[i][name_key])) == i && records[i][decoded_key].dump() == "\"" + name_key + "\"";
+    CHECK(intact);
+}
+
+/* 字段投影：只保留选中的路径，路径的前缀保留整个值，缺少的键或路径上不是对象的值不出现在结果中 */
+static void test_projection() {
+    string text = "{\"id\":7,\"user\":{\"name\":\"n\",\"email\":\"e\",\"geo\":{\"lat\":1.5,\"lng\":2}},"
+                  "\"tags\":[\"a\",{\"b\":1}],\"skip\":{\"x\":[1,2,{\"y\":\"}\"}]},\"a/b\":true}";
+    auto project = [&text](const vector<string> &paths) {
+        return JSON::parse_projected(text, JSONProjection(paths)).dump();
+    };
+    CHECK(project({"/id"}) == "{\"id\":7}");
+    CHECK(project({"/user/name", "/user/geo/lat", "/tags"}) ==
+          "{\"user\":{\"name\":\"n\",\"geo\":{\"lat\":1.5}},\"tags\":[\"a\",{\"b\":1}]}");
+    CHECK(project({"/user/geo/lat", "/user"}) == "{\"user\":" + JSON(text)["user"].dump() + "}");
+    CHECK(project({"/missing", "/id/deeper", "/tags/0", "/a~1b"}) == "{\"a/b\":true}");
+    CHECK(project({""}) == JSON(text).dump());
+    auto throws = [](const std::function<void()> &parse) {
+        try {
+            parse();
+        } catch (const std::runtime_error &) {
+            return true;
+        }
+        return false;
+    };
+    CHECK(throws([]() { JSONProjection projection(vector<string>{}); }));
+    CHECK(throws([]() { JSONProjection projection({"no-slash"}); }));
+    CHECK(throws([]() { JSON::parse_projected("{\"id\":1", JSONProjection({"/id"})); }));
+    CHECK(throws([]() { JSON::parse_projected("{\"id\":tru}", JSONProjection({"/id"})); }));
+}
+
+/* NDJSON：多批、多线程解析时记录仍按输入的顺序交给callback，出错时报告所在的行 */
+static void test_ndjson() {
+    string text;
+    const size_t records = 60000;   // 约3MB，分成多批
+    for (size_t i = 0; i < records; ++i) {
+        text += "{\"id\":" + std::to_string(i) + ",\"name\":\"record number " + std::to_string(i) + "\"}\n";
+        if (i % 1000 == 0) text += "\n   \r\n";     // 空行被忽略
+    }
+    for (unsigned threads: {1u, 4u}) {
+        size_t next = 0;
+        bool ordered = true;
+        size_t total = parse_ndjson(text, [&](vector<JSON> &batch) {
+            for (JSON &record: batch) ordered &= static_cast<size_t>(static_cast<long long>(record["id"])) == next++;
+        }, threads);
+        CHECK(total == records && next == records && ordered);
+    }
+    size_t projected = 0;
+    parse_ndjson(text, JSONProjection({"/id"}), [&](vector<JSON> &batch) {
+        for (JSON &record: batch) projected += record.size() == 1 && record.at("id").isInteger();
+    }, 4);
+    CHECK(projected == records);
+
+    // 第50001行不合法：之前的记录都已交给callback，异常信息中是该行的行号
+    string broken;
+    bool ordered_prefix = true;
+    for (size_t i = 0; i < records; ++i)
+        broken += i == 50000 ? "{\"id\":}\n" : "[" + std::to_string(i) + ",\"" + string(40, 'p') + "\"]\n";
+    size_t delivered = 0;
+    string message;
+    try {
+        parse_ndjson(broken, [&](vector<JSON> &batch) {
+            for (JSON &record: batch) ordered_prefix &= static_cast<size_t>(static_cast<long long>(record[0])) == delivered++;
+        }, 4);
+    } catch (const std::runtime_error &e) {
+        message = e.what();
+    }
+    CHECK(message.find("line 50001 ") != string::npos && delivered > 0 && delivered <= 50000 && ordered_prefix);
+    try {
+        parse_ndjson("1\n2\n[3] x\n", [](vector<JSON> &) {});
+        message.clear();
+    } catch (const std::runtime_error &e) {
+        message = e.what();
+    }
+    CHECK(message.find("Unexpected characters") != string::npos && message.find("line 3 (byte 4)") != string::npos);
+}
+
+/* JSON Pointer：转义的'~'和'/'、数组下标、"-"和不存在的路径 */
+static void test_json_pointer() {
+    JSON json("{\"a/b\":1,\"m~n\":2,\"~1\":3,\"\":4,\"list\":[10,[20,21],{\"k\":\"v\"}],\"01\":5,\"x\":{\"\":{\"y\":6}}}");
+    CHECK(&json.at_pointer("") == &json);
+    CHECK(static_cast<int>(json.at_pointer("/a~1b")) == 1);
+    CHECK(static_cast<int>(json.at_pointer("/m~0n")) == 2);
+    CHECK(static_cast<int>(json.at_pointer("/~01")) == 3);      // 先还原~0，得到的"~1"不再还原
+    CHECK(static_cast<int>(json.at_pointer("/")) == 4);
+    CHECK(static_cast<int>(json.at_pointer("/list/0")) == 10);
+    CHECK(static_cast<int>(json.at_pointer("/list/1/1")) == 21);
+    CHECK(json.at_pointer("/list/2/k").dump() == "\"v\"");
+    CHECK(static_cast<int>(json.at_pointer("/01")) == 5);       // 对象的键不受下标语法的限制
+    CHECK(static_cast<int>(json.at_pointer("/x//y")) == 6);
+
+    auto missing = [&json](const string &path) {
+        try {
+            json.at_pointer(path);
+        } catch (const std::out_of_range &) {
+            return JSONPointer(path).find(json) == nullptr;
+        }
+        return false;
+    };
+    CHECK(missing("/list/3") && missing("/list/-") && missing("/list/01") && missing("/list/-1"));
+    CHECK(missing("/list/99999999999999999999") && missing("/list/0/x") && missing("/nope") && missing("/a/b"));
+    for (const char *bad: {"a", "/~", "/~2", "/a~"}) {
+        bool thrown = false;
+        try {
+            JSONPointer pointer(bad);
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+    JSONPointer compiled("/list/1/0");
+    CHECK(compiled.size() == 3 && static_cast<int>(*compiled.find(json)) == 20);
+    CHECK(compiled.find(JSON("{\"list\":[]}")) == nullptr);
+}
+
+/* 增量解析：输入在任何位置切开分块送入，结果都与一次解析相同 */
+static void test_stream_parser() {
+    string text = " {\"name\":\"a \\\"quoted\\\" \\u4e2d string that is long\",\"n\":-12.5e2,\"big\":18446744073709551615,"
+                  "\"list\":[true,false,null,[],{},\"\"],\"nested\":{\"k\":[1,{\"x\":\"y\"}]}} ";
+    JSON expected(text);
+    for (size_t split = 0; split <= text.size(); ++split) {
+        JSON json;
+        JSONStreamParser parser(json);
+        parser.feed(text.substr(0, split));
+        parser.feed(text.substr(split));
+        parser.finish();
+        CHECK(parser.done() && json == expected);
+    }
+    JSON bytewise;
+    JSONStreamParser parser(bytewise);
+    for (char c: text) parser.feed(&c, 1);
+    parser.finish();
+    CHECK(bytewise == expected);
+
+    std::istringstream in(text);
+    JSON streamed;
+    in >> streamed;
+    CHECK(streamed == expected);
+
+    auto rejects = [](const string &input) {
+        try {
+            JSON json;
+            JSONStreamParser parser(json);
+            parser.feed(input);
+            parser.finish();
+        } catch (const std::runtime_error &) {
+            return true;
+        }
+        return false;
+    };
+    CHECK(rejects("{\"a\":1") && rejects("[1,2") && rejects("[\"abc") && rejects("[1,]") && rejects("{\"a\" 1}"));
+    CHECK(rejects("[tru]") && rejects("[1e]"));
+}
+
+/* 快照与原值共享子树，之后任何一方的修改都不影响另一方 */
+static void test_snapshot_isolation() {
+    JSON original("{\"user\":{\"name\":\"a long name that is not inlined\",\"tags\":[1,2,3]},\"n\":1}");
+    string before = original.dump();
+    JSON copy = original.snapshot();
+    copy["user"]["tags"].push_back(4);
+    copy["user"]["name"] = "b";
+    copy["extra"] = true;
+    CHECK(original.dump() == before);
+    CHECK(copy.dump() == "{\"user\":{\"name\":\"b\",\"tags\":[1,2,3,4]},\"n\":1,\"extra\":true}");
+
+    JSON second = original.snapshot();
+    original["user"]["tags"].pop(0);
+    original.remove("n");
+    original["user"].merge(JSON("{\"age\":3}"));
+    CHECK(second.dump() == before);
+    CHECK(original.dump() == "{\"user\":{\"name\":\"a long name that is not inlined\",\"tags\":[2,3],\"age\":3}}");
+
+    // 快照的快照，以及只读访问不会复制或影响共享的子树
+    JSON third = second.snapshot();
+    const JSON &view = third;
+    CHECK(view.at("user").at("tags").size() == 3);
+    third["user"]["tags"][0] = 9;
+    CHECK(second.dump() == before && static_cast<int>(third["user"]["tags"][0]) == 9);
+    JSON deep(second);
+    second["n"] = 2;
+    CHECK(static_cast<int>(deep["n"]) == 1 && static_cast<int>(third["n"]) == 1);
+}
+
+/* 添加键值对或元素不会移动已有的子节点：之前得到的引用仍然有效，用同一对象中的值给新键赋值也是安全的 */
+static void test_stable_children() {
+    JSON obj("{\"a\":1}");
+    obj["c"] = obj["a"];
+    CHECK(obj.dump() == "{\"a\":1,\"c\":1}");
+    JSON &a = obj["a"];
+    for (int i = 0; i < 100; ++i) obj["k" + std::to_string(i)] = i;
+    a = 5;
+    CHECK(static_cast<int>(obj["a"]) == 5 && static_cast<int>(obj["k99"]) == 99);
+    obj["d"] = obj["k50"];
+    CHECK(static_cast<int>(obj["d"]) == 50 && obj.size() == 103);
+
+    JSON arr("[\"first\"]");
+    JSON &head = arr[0];
+    for (int i = 0; i < 100; ++i) arr.push_back(arr[0]);
+    head = "changed";
+    CHECK(arr.size() == 101 && arr[0].dump() == "\"changed\"" && arr[100].dump() == "\"first\"");
+    arr.pop(0);
+    CHECK(arr.size() == 100 && arr[99].dump() == "\"first\"");
+    obj.remove("a");
+    CHECK(obj.size() == 102 && static_cast<int>(obj["c"]) == 1);
+}
+
+/* MessagePack往返不改变值；截断或损坏的输入报错，且不按其中声明的长度分配内存 */
+static void test_msgpack() {
+    JSON json("{\"id\":-5,\"big\":18446744073709551615,\"pi\":3.25,\"ok\":true,\"none\":null,"
+              "\"name\":\"a rather long string value\",\"list\":[1,[2,{}],[],\"x\"],\"nested\":{\"k\":-200000}}");
+    string packed = json.dump_msgpack();
+    CHECK(JSON::parse_msgpack(packed) == json);
+    std::istringstream in(packed + packed);
+    CHECK(JSON::parse_msgpack(in) == json && JSON::parse_msgpack(in) == json);
+    string text = "[\"" + string(200000, 'v') + "\"]";
+    std::istringstream large(JSON(text).dump_msgpack());
+    CHECK(JSON::parse_msgpack(large).dump() == text);
+
+    auto rejects = [](const string &data) {
+        bool from_string = false, from_stream = false;
+        try {
+            JSON::parse_msgpack(data);
+        } catch (const std::runtime_error &) {
+            from_string = true;
+        }
+        try {
+            std::istringstream in(data);
+            JSON::parse_msgpack(in);
+        } catch (const std::runtime_error &) {
+            from_stream = true;
+        }
+        return from_string && from_stream;
+    };
+    for (size_t n = 0; n < packed.size(); ++n) CHECK(rejects(packed.substr(0, n)));
+    CHECK(rejects(string("\xDD\xFF\xFF\xFF\xFF\x01", 6)));      // 声明了约40亿个元素的数组
+    CHECK(rejects(string("\xDF\xFF\xFF\xFF\xFF\xA1k\x01", 8))); // 声明了约40亿个键值对的对象
+    CHECK(rejects(string("\xDB\xFF\xFF\xFF\xFF" "abc", 8)));    // 声明了4GB的字符串
+    CHECK(rejects(string("\x81\x01\x02", 3)));                  // 键不是字符串
+    CHECK(rejects(string("\xC1", 1)));                          // 未定义的类型
+    CHECK(rejects(string(2000, '\x91') + '\x01'));              // 嵌套过深
+    bool trailing = false;
+    try {
+        JSON::parse_msgpack(packed + '\x01');
+    } catch (const std::runtime_error &) {
+        trailing = true;
+    }
+    CHECK(trailing);
+}
+
+/* 磁带与DOM表示同样的值：由文本或由JSON构造的磁带转换回来与直接解析的结果相同，游标读出的值一致 */
+static void test_tape() {
+    string long_key(40, 'k');
+    for (const string &text: {string("[]"), string("{}"), string("[1,-2,3.5,true,false,null,\"s\",[],{}]"),
+                              string("{\"a\":{\"b\":[1,{\"c\":\"x,y:[{\"}]},\"" + long_key + "\":18446744073709551615}"),
+                              string(" [ {\"id\" : 1 , \"tags\" : [ \"a\" , \"b\" ] } , {\"id\":2,\"tags\":[]} ] ")}) {
+        JSON json(text);
+        CHECK(JSONTape(text).to_json() == json);
+        CHECK(JSONTape(json).to_json() == json);
+        CHECK(JSONTape(text).root().to_json().dump() == json.dump());
+    }
+    JSONTape tape("{\"list\":[10,\"two\",3.5,{\"k\":null}],\"flag\":true}");
+    auto list = tape.root().at("list");
+    CHECK(tape.root().size() == 2 && list.isJSONArray() && list.size() == 4);
+    CHECK(static_cast<long long>(list[0]) == 10 && static_cast<std::string_view>(list[1]) == "two");
+    CHECK(static_cast<double>(list[2]) == 3.5 && list[3].at("k").isNULL());
+    CHECK(static_cast<bool>(tape.root().at("flag")) && !tape.root().find("missing"));
+    size_t count = 0;
+    for (auto item = list.child(); !item.at_end(); item = item.next()) ++count;
+    CHECK(count == 4);
+}
+
+int main() {
+    test_document();
+    test_wide_object();
+    test_block_scanning();
+    test_sax();
+    test_dump();
+    test_dump_parallel_lazy();
+    test_move_semantics();
+    test_accessors();
+    test_parse_file();
+    test_lazy_document();
+    test_move_number_text();
+    test_number_underflow();
+    test_malformed_numbers();
+    test_try_parse_errors();
+    test_equal_duplicate_keys();
+    test_nesting_limit();
+    test_stream_parser();
+    test_shared_keys();
+    test_projection();
+    test_ndjson();
+    test_parse_parallel();
+    test_struct_binding();
+    test_json_pointer();
+    test_snapshot_isolation();
+    test_stable_children();
+    test_msgpack();
+    test_tape();
+    if (failures) std::cerr << failures << " check(s) failed" << endl;
+    else cout << "All tests passed" << endl;
+    return failures;
+}